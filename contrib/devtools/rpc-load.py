@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+'''
+Generate concurrent JSON-RPC load against a running (regtest) node and report
+latency percentiles of cheap and expensive calls separately.
+
+Some clients issue a stream of expensive calls (getblock with full transaction
+details), while others issue cheap calls (getblockcount). With a single shared
+work queue (-rpcexpensivethreads=0) the cheap calls wait behind the expensive
+ones; with the default separate workers for expensive calls they should not.
+'''
+
+import argparse
+import base64
+import http.client
+import json
+import threading
+import time
+
+CHEAP_CALLS = [
+    ('getblockcount', []),
+    ('getbestblockhash', []),
+    ('getnetworkinfo', []),
+]
+
+
+def percentile(values, pct):
+    if not values:
+        return float('nan')
+    values = sorted(values)
+    index = min(len(values) - 1, int(round(pct / 100.0 * (len(values) - 1))))
+    return values[index]
+
+
+class Client:
+    def __init__(self, args):
+        self.conn = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+        auth = '{}:{}'.format(args.user, args.password).encode('utf8')
+        self.headers = {
+            'Authorization': 'Basic ' + base64.b64encode(auth).decode('ascii'),
+            'Content-Type': 'application/json',
+        }
+        self.next_id = 0
+
+    def call(self, method, params):
+        self.next_id += 1
+        body = json.dumps({'jsonrpc': '1.0', 'id': self.next_id, 'method': method, 'params': params})
+        self.conn.request('POST', '/', body, self.headers)
+        response = self.conn.getresponse()
+        reply = json.loads(response.read().decode('utf8'))
+        if reply.get('error') is not None:
+            raise RuntimeError('{} failed: {}'.format(method, reply['error']))
+        return reply['result']
+
+
+def run_worker(args, calls, deadline, latencies, lock):
+    client = Client(args)
+    samples = []
+    i = 0
+    while time.monotonic() < deadline:
+        method, params = calls[i % len(calls)]
+        i += 1
+        start = time.monotonic()
+        client.call(method, params)
+        samples.append(time.monotonic() - start)
+    with lock:
+        latencies.extend(samples)
+
+
+def expensive_calls(args):
+    client = Client(args)
+    height = client.call('getblockcount', [])
+    calls = []
+    for h in range(max(0, height - args.blocks + 1), height + 1):
+        calls.append(('getblock', [client.call('getblockhash', [h]), 2]))
+    return calls
+
+
+def report(name, latencies, duration):
+    print('{:10} calls={:7d} rate={:9.1f}/s p50={:8.2f}ms p90={:8.2f}ms p99={:8.2f}ms max={:8.2f}ms'.format(
+        name, len(latencies), len(latencies) / duration,
+        percentile(latencies, 50) * 1000, percentile(latencies, 90) * 1000,
+        percentile(latencies, 99) * 1000, max(latencies, default=float('nan')) * 1000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=16443, help='RPC port (default: %(default)s, regtest)')
+    parser.add_argument('--user', required=True, help='RPC user, or __cookie__ with the cookie password')
+    parser.add_argument('--password', required=True)
+    parser.add_argument('--cheap-clients', type=int, default=8, help='concurrent clients issuing cheap calls (default: %(default)s)')
+    parser.add_argument('--expensive-clients', type=int, default=4, help='concurrent clients issuing getblock calls (default: %(default)s)')
+    parser.add_argument('--blocks', type=int, default=100, help='number of most recent blocks requested by the expensive clients (default: %(default)s)')
+    parser.add_argument('--duration', type=float, default=10.0, help='seconds to run (default: %(default)s)')
+    parser.add_argument('--timeout', type=float, default=60.0, help='per call timeout in seconds (default: %(default)s)')
+    args = parser.parse_args()
+
+    groups = [
+        ('cheap', CHEAP_CALLS, args.cheap_clients),
+        ('expensive', expensive_calls(args), args.expensive_clients),
+    ]
+    lock = threading.Lock()
+    results = {name: [] for name, _, _ in groups}
+    deadline = time.monotonic() + args.duration
+    threads = []
+    for name, calls, count in groups:
+        for _ in range(count):
+            thread = threading.Thread(target=run_worker, args=(args, calls, deadline, results[name], lock))
+            thread.start()
+            threads.append(thread)
+    for thread in threads:
+        thread.join()
+
+    for name, _, _ in groups:
+        report(name, results[name], args.duration)
+
+
+if __name__ == '__main__':
+    main()
@@ -3,8 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bench/bench.h>
+#include <chainparams.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
+#include <miner.h>
 #include <test/util/mining.h>
 #include <test/util/setup_common.h>
 #include <test/util/wallet.h>
@@ -14,7 +16,7 @@
 
 #include <vector>
 
-static void AssembleBlock(benchmark::Bench& bench)
+static void AssembleBlockTemplate(benchmark::Bench& bench, bool extend_selection)
 {
     TestingSetup test_setup{
         CBaseChainParams::REGTEST,
@@ -54,9 +56,28 @@ static void AssembleBlock(benchmark::Bench& bench)
         }
     }
 
-    bench.run([&] {
-        PrepareBlock(test_setup.m_node, SCRIPT_PUB);
-    });
+    if (extend_selection) {
+        // Each template extends the selection made for the last one
+        BlockTemplateSelection selection;
+        bench.run([&] {
+            BlockAssembler{*test_setup.m_node.mempool, Params()}.CreateNewBlock(SCRIPT_PUB, &selection);
+        });
+    } else {
+        bench.run([&] {
+            PrepareBlock(test_setup.m_node, SCRIPT_PUB);
+        });
+    }
+}
+
+static void AssembleBlock(benchmark::Bench& bench)
+{
+    AssembleBlockTemplate(bench, /* extend_selection */ false);
+}
+
+static void AssembleBlockExtendSelection(benchmark::Bench& bench)
+{
+    AssembleBlockTemplate(bench, /* extend_selection */ true);
 }
 
 BENCHMARK(AssembleBlock);
+BENCHMARK(AssembleBlockExtendSelection);
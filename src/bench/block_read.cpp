@@ -0,0 +1,64 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <script/standard.h>
+#include <test/util/mining.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+#include <vector>
+
+static constexpr size_t NUM_BLOCKS{100};
+
+static std::vector<const CBlockIndex*> MineBlocks(const TestingSetup& test_setup)
+{
+    const CScript script_pub{CScript{} << OP_TRUE};
+    for (size_t i = 0; i < NUM_BLOCKS; ++i) {
+        MineBlock(test_setup.m_node, script_pub);
+    }
+    std::vector<const CBlockIndex*> blocks;
+    LOCK(::cs_main);
+    for (const CBlockIndex* pindex = ::ChainActive().Tip(); pindex && pindex->nHeight > 0; pindex = pindex->pprev) {
+        blocks.push_back(pindex);
+    }
+    return blocks;
+}
+
+static void ReadBlock(benchmark::Bench& bench, bool check_hash, bool mapped)
+{
+    TestingSetup test_setup{
+        CBaseChainParams::REGTEST,
+        /* extra_args */ {
+            "-nodebuglogfile",
+            "-nodebug",
+        },
+    };
+    const std::vector<const CBlockIndex*> blocks{MineBlocks(test_setup)};
+    const Consensus::Params& params{Params().GetConsensus()};
+    SetMappedBlockFiles(mapped ? 32 : 0);
+
+    bench.batch(blocks.size()).unit("block").run([&] {
+        for (const CBlockIndex* pindex : blocks) {
+            CBlock block;
+            bool ret{check_hash ? ReadBlockFromDisk(block, pindex, params) :
+                                  ReadBlockFromDisk(block, WITH_LOCK(::cs_main, return pindex->GetBlockPos()), params)};
+            assert(ret);
+        }
+    });
+    SetMappedBlockFiles(DEFAULT_MMAP_BLOCK_FILES);
+}
+
+/** Read blocks by position, checking their proof of work */
+static void ReadBlockFromDiskPoW(benchmark::Bench& bench) { ReadBlock(bench, false, true); }
+/** Read blocks by index, checking their hash */
+static void ReadBlockFromDiskHash(benchmark::Bench& bench) { ReadBlock(bench, true, true); }
+/** Read blocks by index with file I/O rather than from memory mapped files */
+static void ReadBlockFromDiskHashFileIO(benchmark::Bench& bench) { ReadBlock(bench, true, false); }
+
+BENCHMARK(ReadBlockFromDiskPoW);
+BENCHMARK(ReadBlockFromDiskHash);
+BENCHMARK(ReadBlockFromDiskHashFileIO);
@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 #include <coins.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <script/signingprovider.h>
 #include <test/util/transaction_utils.h>
 
@@ -52,3 +53,52 @@ static void CCoinsCaching(benchmark::Bench& bench)
 }
 
 BENCHMARK(CCoinsCaching);
+
+// Fill a cache with P2PKH-sized coins and flush it, which exercises node
+// allocation from and release to the pool backing CCoinsMap.
+static void CCoinsCacheFill(benchmark::Bench& bench)
+{
+    constexpr uint32_t NUM_COINS = 100000;
+    FastRandomContext rng(true);
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(NUM_COINS);
+    for (uint32_t i = 0; i < NUM_COINS; ++i) {
+        outpoints.emplace_back(rng.rand256(), i);
+    }
+    const CScript script = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins(&coinsDummy);
+    bench.batch(NUM_COINS).unit("coin").run([&] {
+        for (const COutPoint& outpoint : outpoints) {
+            coins.AddCoin(outpoint, Coin(CTxOut(1, script), 1, false, false), false);
+        }
+        coins.Flush();
+    });
+}
+
+static void CCoinsCacheLookup(benchmark::Bench& bench)
+{
+    constexpr uint32_t NUM_COINS = 100000;
+    FastRandomContext rng(true);
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(NUM_COINS);
+    const CScript script = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins(&coinsDummy);
+    for (uint32_t i = 0; i < NUM_COINS; ++i) {
+        outpoints.emplace_back(rng.rand256(), i);
+        coins.AddCoin(outpoints.back(), Coin(CTxOut(1, script), 1, false, false), false);
+    }
+
+    bench.batch(NUM_COINS).unit("coin").run([&] {
+        for (const COutPoint& outpoint : outpoints) {
+            bool found = coins.HaveCoinInCache(outpoint);
+            assert(found);
+        }
+    });
+}
+
+BENCHMARK(CCoinsCacheFill);
+BENCHMARK(CCoinsCacheLookup);
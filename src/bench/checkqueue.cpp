@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 #include <checkqueue.h>
+#include <crypto/sha256.h>
 #include <key.h>
 #include <prevector.h>
 #include <pubkey.h>
@@ -12,12 +13,15 @@
 
 #include <boost/thread/thread.hpp>
 
+#include <utility>
 #include <vector>
 
 static const size_t BATCHES = 101;
 static const size_t BATCH_SIZE = 30;
 static const int PREVECTOR_SIZE = 28;
 static const unsigned int QUEUE_BATCH_SIZE = 128;
+//! Number of SHA256 compressions per check in the scaling benchmarks
+static const int HASH_ROUNDS = 16;
 
 // This Benchmark tests the CheckQueue with a slightly realistic workload,
 // where checks all contain a prevector that is indirect 50% of the time
@@ -75,3 +79,55 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
     ECC_Stop();
 }
 BENCHMARK(CCheckQueueSpeedPrevectorJob);
+
+// Run checks that each do a little hashing, with a given number of worker
+// threads besides the main thread, to measure how the queue scales.
+static void CCheckQueueScaling(benchmark::Bench& bench, int worker_threads)
+{
+    // Oversubscribed cores would measure the scheduler rather than the queue.
+    if (worker_threads >= GetNumCores()) return;
+
+    struct HashJob {
+        unsigned char data[64]{};
+        bool operator()()
+        {
+            unsigned char hash[CSHA256::OUTPUT_SIZE];
+            for (int i = 0; i < HASH_ROUNDS; ++i) {
+                CSHA256().Write(data, sizeof(data)).Finalize(hash);
+                data[0] = hash[0];
+            }
+            return true;
+        }
+        void swap(HashJob& x) { std::swap(data, x.data); }
+    };
+    CCheckQueue<HashJob> queue {QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    for (auto x = 0; x < worker_threads; ++x) {
+       tg.create_thread([&]{queue.Thread();});
+    }
+
+    std::vector<std::vector<HashJob>> vBatches(BATCHES, std::vector<HashJob>(BATCH_SIZE));
+    bench.minEpochIterations(10).batch(BATCH_SIZE * BATCHES).unit("job").run([&] {
+        CCheckQueueControl<HashJob> control(&queue);
+        for (auto vChecks : vBatches) {
+            control.Add(vChecks);
+        }
+        control.Wait();
+    });
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+static void CCheckQueueScaling1(benchmark::Bench& bench) { CCheckQueueScaling(bench, 1); }
+static void CCheckQueueScaling3(benchmark::Bench& bench) { CCheckQueueScaling(bench, 3); }
+static void CCheckQueueScaling7(benchmark::Bench& bench) { CCheckQueueScaling(bench, 7); }
+static void CCheckQueueScaling15(benchmark::Bench& bench) { CCheckQueueScaling(bench, 15); }
+static void CCheckQueueScaling31(benchmark::Bench& bench) { CCheckQueueScaling(bench, 31); }
+static void CCheckQueueScaling63(benchmark::Bench& bench) { CCheckQueueScaling(bench, 63); }
+
+BENCHMARK(CCheckQueueScaling1);
+BENCHMARK(CCheckQueueScaling3);
+BENCHMARK(CCheckQueueScaling7);
+BENCHMARK(CCheckQueueScaling15);
+BENCHMARK(CCheckQueueScaling31);
+BENCHMARK(CCheckQueueScaling63);
@@ -5,6 +5,8 @@
 #include <bench/bench.h>
 #include <interfaces/chain.h>
 #include <node/context.h>
+#include <test/util/setup_common.h>
+#include <wallet/coincontrol.h>
 #include <wallet/coinselection.h>
 #include <wallet/wallet.h>
 
@@ -114,5 +116,75 @@ static void BnBExhaustion(benchmark::Bench& bench)
     });
 }
 
+// Large wallet benchmarks: a wallet holding many confirmed UTXOs paying to
+// one of its own keys, as seen by AvailableCoins and SelectCoins when
+// funding a transaction.
+static constexpr int LARGE_WALLET_UTXOS = 20000;
+
+static void AddLargeWalletCoins(CWallet& wallet)
+{
+    CTxDestination dest;
+    std::string error;
+    if (!wallet.GetNewDestination(OutputType::BECH32, "", dest, error)) assert(false);
+    const CScript script_pub_key = GetScriptForDestination(dest);
+
+    for (int i = 0; i < LARGE_WALLET_UTXOS; ++i) {
+        CMutableTransaction tx;
+        tx.nLockTime = i; // so all transactions get different hashes
+        tx.vout.emplace_back(1000 * (i + 1), script_pub_key);
+        const CWalletTx::Confirmation confirm(CWalletTx::Status::CONFIRMED, /* block_height */ 1, /* block_hash */ uint256::ONE, /* index */ 1);
+        if (!wallet.AddToWallet(MakeTransactionRef(std::move(tx)), boost::none, confirm)) assert(false);
+    }
+
+    LOCK(wallet.cs_wallet);
+    wallet.SetLastBlockProcessed(/* block_height */ 100, uint256::ONE);
+}
+
+static void LargeWallet(benchmark::Bench& bench, const bool select_coins)
+{
+    TestingSetup test_setup{
+        CBaseChainParams::REGTEST,
+        /* extra_args */ {
+            "-nodebuglogfile",
+            "-nodebug",
+        },
+    };
+
+    std::unique_ptr<interfaces::Chain> chain = interfaces::MakeChain(test_setup.m_node);
+    CWallet wallet{chain.get(), "", CreateMockWalletDatabase()};
+    {
+        wallet.SetupLegacyScriptPubKeyMan();
+        bool first_run;
+        if (wallet.LoadWallet(first_run) != DBErrors::LOAD_OK) assert(false);
+    }
+    AddLargeWalletCoins(wallet);
+
+    const CCoinControl coin_control;
+    CoinSelectionParams coin_selection_params(/* use_bnb= */ true, /* change_output_size= */ 31, /* mweb_change_output_weight= */ 0,
+                                              /* change_spend_size= */ 68, /* effective_feerate= */ CFeeRate(10000),
+                                              /* long_term_feerate= */ CFeeRate(1000), /* discard_feerate= */ CFeeRate(3000),
+                                              /* tx_no_inputs_size= */ 11, /* mweb_no_change_weight= */ 0);
+
+    LOCK(wallet.cs_wallet);
+    bench.run([&] {
+        std::vector<COutputCoin> coins;
+        wallet.AvailableCoins(coins, /* fOnlySafe */ true, &coin_control);
+        assert(coins.size() == LARGE_WALLET_UTXOS);
+        if (!select_coins) return;
+
+        std::set<CInputCoin> setCoinsRet;
+        CAmount nValueRet = 0;
+        bool bnb_used;
+        bool success = wallet.SelectCoins(coins, 10 * COIN, setCoinsRet, nValueRet, coin_control, coin_selection_params, bnb_used);
+        assert(success);
+        assert(nValueRet >= 10 * COIN);
+    });
+}
+
+static void AvailableCoinsLargeWallet(benchmark::Bench& bench) { LargeWallet(bench, /* select_coins */ false); }
+static void CoinSelectionLargeWallet(benchmark::Bench& bench) { LargeWallet(bench, /* select_coins */ true); }
+
 BENCHMARK(CoinSelection);
 BENCHMARK(BnBExhaustion);
+BENCHMARK(AvailableCoinsLargeWallet);
+BENCHMARK(CoinSelectionLargeWallet);
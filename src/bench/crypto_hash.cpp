@@ -89,6 +89,40 @@ static void SipHash_32b(benchmark::Bench& bench)
     });
 }
 
+static void SipHash_32b_Batch(benchmark::Bench& bench)
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> vals(1024);
+    std::vector<const uint256*> val_ptrs;
+    for (uint256& val : vals) {
+        val = rng.rand256();
+        val_ptrs.push_back(&val);
+    }
+    std::vector<uint64_t> hashes(vals.size());
+    uint64_t k1 = 0;
+    bench.batch(vals.size()).unit("hash").run([&] {
+        SipHashUint256Batch(0, ++k1, val_ptrs.data(), val_ptrs.size(), hashes.data());
+    });
+}
+
+static void SipHash_32b_Extra_Batch(benchmark::Bench& bench)
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> vals(1024);
+    std::vector<const uint256*> val_ptrs;
+    std::vector<uint32_t> extra;
+    for (uint256& val : vals) {
+        val = rng.rand256();
+        val_ptrs.push_back(&val);
+        extra.push_back(extra.size());
+    }
+    std::vector<uint64_t> hashes(vals.size());
+    uint64_t k1 = 0;
+    bench.batch(vals.size()).unit("hash").run([&] {
+        SipHashUint256ExtraBatch(0, ++k1, val_ptrs.data(), extra.data(), val_ptrs.size(), hashes.data());
+    });
+}
+
 static void FastRandom_32bit(benchmark::Bench& bench)
 {
     FastRandomContext rng(true);
@@ -113,6 +147,8 @@ BENCHMARK(SHA3_256_1M);
 
 BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
+BENCHMARK(SipHash_32b_Batch);
+BENCHMARK(SipHash_32b_Extra_Batch);
 BENCHMARK(SHA256D64_1024);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
@@ -5,15 +5,22 @@
 #include <bench/bench.h>
 #include <blockfilter.h>
 
-static void ConstructGCSFilter(benchmark::Bench& bench)
+static GCSFilter::ElementSet GenerateGCSTestElements(int offset = 0)
 {
     GCSFilter::ElementSet elements;
     for (int i = 0; i < 10000; ++i) {
         GCSFilter::Element element(32);
         element[0] = static_cast<unsigned char>(i);
         element[1] = static_cast<unsigned char>(i >> 8);
+        element[2] = static_cast<unsigned char>(offset);
         elements.insert(std::move(element));
     }
+    return elements;
+}
+
+static void ConstructGCSFilter(benchmark::Bench& bench)
+{
+    GCSFilter::ElementSet elements = GenerateGCSTestElements();
 
     uint64_t siphash_k0 = 0;
     bench.batch(elements.size()).unit("elem").run([&] {
@@ -23,15 +30,20 @@ static void ConstructGCSFilter(benchmark::Bench& bench)
     });
 }
 
+static void DecodeGCSFilter(benchmark::Bench& bench)
+{
+    GCSFilter::ElementSet elements = GenerateGCSTestElements();
+    GCSFilter filter({0, 0, 20, 1 << 20}, elements);
+    const std::vector<unsigned char>& encoded = filter.GetEncoded();
+
+    bench.batch(elements.size()).unit("elem").run([&] {
+        GCSFilter decoded({0, 0, 20, 1 << 20}, encoded);
+    });
+}
+
 static void MatchGCSFilter(benchmark::Bench& bench)
 {
-    GCSFilter::ElementSet elements;
-    for (int i = 0; i < 10000; ++i) {
-        GCSFilter::Element element(32);
-        element[0] = static_cast<unsigned char>(i);
-        element[1] = static_cast<unsigned char>(i >> 8);
-        elements.insert(std::move(element));
-    }
+    GCSFilter::ElementSet elements = GenerateGCSTestElements();
     GCSFilter filter({0, 0, 20, 1 << 20}, elements);
 
     bench.unit("elem").run([&] {
@@ -39,5 +51,38 @@ static void MatchGCSFilter(benchmark::Bench& bench)
     });
 }
 
+/** Match the element sets of 16 wallets against a filter one set at a time */
+static void MatchAnyGCSFilter(benchmark::Bench& bench)
+{
+    GCSFilter filter({0, 0, 20, 1 << 20}, GenerateGCSTestElements());
+    std::vector<GCSFilter::ElementSet> element_sets;
+    for (int i = 1; i <= 16; ++i) {
+        element_sets.push_back(GenerateGCSTestElements(i));
+    }
+
+    bench.batch(element_sets.size()).unit("set").run([&] {
+        for (const GCSFilter::ElementSet& elements : element_sets) {
+            filter.MatchAny(elements);
+        }
+    });
+}
+
+/** Match the element sets of 16 wallets against a filter at once */
+static void BatchMatchAnyGCSFilter(benchmark::Bench& bench)
+{
+    GCSFilter filter({0, 0, 20, 1 << 20}, GenerateGCSTestElements());
+    std::vector<GCSFilter::ElementSet> element_sets;
+    for (int i = 1; i <= 16; ++i) {
+        element_sets.push_back(GenerateGCSTestElements(i));
+    }
+
+    bench.batch(element_sets.size()).unit("set").run([&] {
+        filter.MatchAny(element_sets);
+    });
+}
+
 BENCHMARK(ConstructGCSFilter);
+BENCHMARK(DecodeGCSFilter);
 BENCHMARK(MatchGCSFilter);
+BENCHMARK(MatchAnyGCSFilter);
+BENCHMARK(BatchMatchAnyGCSFilter);
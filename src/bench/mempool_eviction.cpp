@@ -6,7 +6,9 @@
 #include <policy/policy.h>
 #include <test/util/setup_common.h>
 #include <txmempool.h>
+#include <validation.h>
 
+#include <vector>
 
 static void AddTx(const CTransactionRef& tx, const CAmount& nFee, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
 {
@@ -138,4 +140,49 @@ static void MempoolEviction(benchmark::Bench& bench)
     });
 }
 
+// Evict from a few chains as deep as the default ancestor limit allows, where
+// every eviction removes the end of a chain and re-linearizes the rest of it.
+static void MempoolEvictionDeepChain(benchmark::Bench& bench)
+{
+    TestingSetup test_setup{
+        CBaseChainParams::REGTEST,
+        /* extra_args */ {
+            "-nodebuglogfile",
+            "-nodebug",
+        },
+    };
+
+    std::vector<CTransactionRef> txs;
+    std::vector<CAmount> fees;
+    for (int chain = 0; chain < 4; ++chain) {
+        CTransactionRef prev;
+        for (unsigned int depth = 0; depth < DEFAULT_ANCESTOR_LIMIT; ++depth) {
+            CMutableTransaction tx = CMutableTransaction();
+            tx.vin.resize(1);
+            if (prev) {
+                tx.vin[0].prevout = COutPoint(prev->GetHash(), 0);
+            }
+            tx.vin[0].scriptSig = CScript() << CScriptNum(chain) << CScriptNum(depth);
+            tx.vin[0].scriptWitness.stack.push_back({1});
+            tx.vout.resize(1);
+            tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            tx.vout[0].nValue = 10 * COIN;
+            prev = MakeTransactionRef(tx);
+            txs.push_back(prev);
+            fees.push_back(depth % 3 == 2 ? 9000LL : 1000LL * (chain + 1));
+        }
+    }
+
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    bench.run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        for (size_t i = 0; i < txs.size(); ++i) {
+            AddTx(txs[i], fees[i], pool);
+        }
+        pool.TrimToSize(pool.DynamicMemoryUsage() * 3 / 4);
+        pool.TrimToSize(0);
+    });
+}
+
 BENCHMARK(MempoolEviction);
+BENCHMARK(MempoolEvictionDeepChain);
@@ -6,17 +6,18 @@
 #include <policy/policy.h>
 #include <test/util/setup_common.h>
 #include <txmempool.h>
+#include <validation.h>
 
 #include <vector>
 
-static void AddTx(const CTransactionRef& tx, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+static void AddTx(const CTransactionRef& tx, CTxMemPool& pool, CAmount fee = 1000) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
 {
     int64_t nTime = 0;
     unsigned int nHeight = 1;
     bool spendsCoinbase = false;
     unsigned int sigOpCost = 4;
     LockPoints lp;
-    pool.addUnchecked(CTxMemPoolEntry(tx, 1000, nTime, nHeight, spendsCoinbase, sigOpCost, lp));
+    pool.addUnchecked(CTxMemPoolEntry(tx, fee, nTime, nHeight, spendsCoinbase, sigOpCost, lp));
 }
 
 struct Available {
@@ -91,4 +92,51 @@ static void ComplexMemPool(benchmark::Bench& bench)
     });
 }
 
+// Chains as deep as the default ancestor limit allows, whose ancestor and
+// descendant state is updated for every transaction added or removed, and
+// whose clusters are linearized for mining and then evicted from.
+static void DeepChainMemPool(benchmark::Bench& bench)
+{
+    int num_chains = 40;
+    if (bench.complexityN() > 1) {
+        num_chains = static_cast<int>(bench.complexityN());
+    }
+
+    std::vector<CTransactionRef> ordered_txs;
+    std::vector<CAmount> fees;
+    for (int chain = 0; chain < num_chains; ++chain) {
+        CTransactionRef prev;
+        for (unsigned int depth = 0; depth < DEFAULT_ANCESTOR_LIMIT; ++depth) {
+            CMutableTransaction tx = CMutableTransaction();
+            tx.vin.resize(1);
+            if (prev) {
+                tx.vin[0].prevout = COutPoint(prev->GetHash(), 0);
+            }
+            tx.vin[0].scriptSig = CScript() << CScriptNum(chain) << CScriptNum(depth);
+            tx.vin[0].scriptWitness.stack.push_back(CScriptNum(chain).getvch());
+            tx.vout.resize(2);
+            for (auto& out : tx.vout) {
+                out.scriptPubKey = CScript() << CScriptNum(chain) << OP_EQUAL;
+                out.nValue = 10 * COIN;
+            }
+            prev = MakeTransactionRef(tx);
+            ordered_txs.push_back(prev);
+            // Every few transactions pays for the ones before it
+            fees.push_back(depth % 5 == 4 ? 20000 : 1000 + 100 * chain);
+        }
+    }
+    TestingSetup test_setup;
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    bench.run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        for (size_t i = 0; i < ordered_txs.size(); ++i) {
+            AddTx(ordered_txs[i], pool, fees[i]);
+        }
+        ankerl::nanobench::doNotOptimizeAway(pool.GetClusters().size());
+        pool.TrimToSize(pool.DynamicMemoryUsage() / 2);
+        pool.TrimToSize(0);
+    });
+}
+
 BENCHMARK(ComplexMemPool);
+BENCHMARK(DeepChainMemPool);
@@ -6,28 +6,55 @@
 #include <bench/data.h>
 
 #include <rpc/blockchain.h>
+#include <rpc/jsonstream.h>
 #include <streams.h>
 #include <validation.h>
 
 #include <univalue.h>
 
-static void BlockToJsonVerbose(benchmark::Bench& bench)
-{
-    CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
-    char a = '\0';
-    stream.write(&a, 1); // Prevent compaction
+namespace {
+
+struct TestBlockAndIndex {
+    CBlock block{};
+    uint256 blockHash{};
+    CBlockIndex blockindex{};
+
+    TestBlockAndIndex()
+    {
+        CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
+        char a = '\0';
+        stream.write(&a, 1); // Prevent compaction
+
+        stream >> block;
+
+        blockHash = block.GetHash();
+        blockindex.phashBlock = &blockHash;
+        blockindex.nBits = 403014710;
+    }
+};
 
-    CBlock block;
-    stream >> block;
+} // namespace
 
-    CBlockIndex blockindex;
-    const uint256 blockHash = block.GetHash();
-    blockindex.phashBlock = &blockHash;
-    blockindex.nBits = 403014710;
+static void BlockToJsonVerbose(benchmark::Bench& bench)
+{
+    TestBlockAndIndex data;
+    bench.run([&] {
+        UniValue univalue = blockToJSON(data.block, &data.blockindex, &data.blockindex, /*verbose*/ true);
+        ankerl::nanobench::doNotOptimizeAway(univalue.write());
+    });
+}
 
+static void BlockToJsonVerboseStream(benchmark::Bench& bench)
+{
+    TestBlockAndIndex data;
+    size_t written = 0;
     bench.run([&] {
-        (void)blockToJSON(block, &blockindex, &blockindex, /*verbose*/ true);
+        JSONStreamWriter writer([&](const std::string& chunk) { written += chunk.size(); });
+        blockToJSON(writer, data.block, &data.blockindex, &data.blockindex, /*verbose*/ true);
+        writer.Flush();
     });
+    ankerl::nanobench::doNotOptimizeAway(written);
 }
 
 BENCHMARK(BlockToJsonVerbose);
+BENCHMARK(BlockToJsonVerboseStream);
@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 #include <rpc/blockchain.h>
+#include <rpc/jsonstream.h>
 #include <txmempool.h>
 
 #include <univalue.h>
@@ -15,11 +16,8 @@ static void AddTx(const CTransactionRef& tx, const CAmount& fee, CTxMemPool& poo
     pool.addUnchecked(CTxMemPoolEntry(tx, fee, /* time */ 0, /* height */ 1, /* spendsCoinbase */ false, /* sigOpCost */ 4, lp));
 }
 
-static void RpcMempool(benchmark::Bench& bench)
+static void FillMempool(CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
 {
-    CTxMemPool pool;
-    LOCK2(cs_main, pool.cs);
-
     for (int i = 0; i < 1000; ++i) {
         CMutableTransaction tx = CMutableTransaction();
         tx.vin.resize(1);
@@ -31,10 +29,33 @@ static void RpcMempool(benchmark::Bench& bench)
         const CTransactionRef tx_r{MakeTransactionRef(tx)};
         AddTx(tx_r, /* fee */ i, pool);
     }
+}
+
+static void RpcMempool(benchmark::Bench& bench)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    FillMempool(pool);
+
+    bench.run([&] {
+        ankerl::nanobench::doNotOptimizeAway(MempoolToJSON(pool, /*verbose*/ true).write());
+    });
+}
+
+static void RpcMempoolStream(benchmark::Bench& bench)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    FillMempool(pool);
 
+    size_t written = 0;
     bench.run([&] {
-        (void)MempoolToJSON(pool, /*verbose*/ true);
+        JSONStreamWriter writer([&](const std::string& chunk) { written += chunk.size(); });
+        MempoolToJSON(writer, pool, /*verbose*/ true);
+        writer.Flush();
     });
+    ankerl::nanobench::doNotOptimizeAway(written);
 }
 
 BENCHMARK(RpcMempool);
+BENCHMARK(RpcMempoolStream);
@@ -0,0 +1,136 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <compat.h>
+#include <net.h>
+#include <netbase.h>
+
+#include <cassert>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#ifdef USE_EPOLL
+
+#include <netinet/in.h>
+#include <poll.h>
+
+static constexpr size_t IDLE_PEERS = 1000;
+static constexpr size_t ACTIVE_PEERS = 8;
+static constexpr int WAIT_TIMEOUT_MILLISECONDS = 50;
+
+/** Loopback TCP connections, of which the first ACTIVE_PEERS get a message on every round. */
+struct LoopbackPeers
+{
+    //! Our end of every connection
+    std::vector<SOCKET> local;
+    //! The peers' end
+    std::vector<SOCKET> remote;
+
+    LoopbackPeers()
+    {
+        SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        assert(listener != INVALID_SOCKET);
+        struct sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        assert(bind(listener, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+        socklen_t len = sizeof(addr);
+        assert(getsockname(listener, (struct sockaddr*)&addr, &len) == 0);
+        assert(listen(listener, SOMAXCONN) == 0);
+
+        for (size_t i = 0; i < IDLE_PEERS + ACTIVE_PEERS; ++i) {
+            SOCKET peer = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            assert(peer != INVALID_SOCKET);
+            assert(connect(peer, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+            SOCKET conn = accept(listener, nullptr, nullptr);
+            assert(conn != INVALID_SOCKET);
+            assert(SetSocketNonBlocking(conn, true));
+            local.push_back(conn);
+            remote.push_back(peer);
+        }
+        CloseSocket(listener);
+    }
+
+    ~LoopbackPeers()
+    {
+        for (SOCKET& s : local) CloseSocket(s);
+        for (SOCKET& s : remote) CloseSocket(s);
+    }
+
+    void SendToActive()
+    {
+        const char msg[32] = {};
+        for (size_t i = 0; i < ACTIVE_PEERS; ++i) {
+            assert(send(remote[i], msg, sizeof(msg), MSG_NOSIGNAL) == sizeof(msg));
+        }
+    }
+
+    //! Read everything waiting on `s`, returning whether anything was read
+    static bool Drain(SOCKET s)
+    {
+        char buf[0x10000];
+        bool read = false;
+        while (recv(s, buf, sizeof(buf), MSG_DONTWAIT) > 0) read = true;
+        return read;
+    }
+};
+
+/** What CConnman::SocketEvents() does with poll: collect every socket, then poll them all. */
+static void SocketEventsPoll(benchmark::Bench& bench)
+{
+    LoopbackPeers peers;
+    bench.unit("round").run([&] {
+        peers.SendToActive();
+
+        std::set<SOCKET> recv_select_set;
+        for (SOCKET s : peers.local) recv_select_set.insert(s);
+        std::unordered_map<SOCKET, struct pollfd> pollfds;
+        for (SOCKET s : recv_select_set) {
+            pollfds[s].fd = s;
+            pollfds[s].events |= POLLIN;
+        }
+        std::vector<struct pollfd> vpollfds;
+        vpollfds.reserve(pollfds.size());
+        for (const auto& it : pollfds) vpollfds.push_back(it.second);
+
+        size_t ready = 0;
+        while (ready < ACTIVE_PEERS) {
+            assert(poll(vpollfds.data(), vpollfds.size(), WAIT_TIMEOUT_MILLISECONDS) >= 0);
+            for (struct pollfd& pollfd_entry : vpollfds) {
+                if ((pollfd_entry.revents & POLLIN) && LoopbackPeers::Drain(pollfd_entry.fd)) ++ready;
+            }
+        }
+    });
+}
+
+/** Persistent edge-triggered registrations, as used by CConnman::SocketHandlerEpoll(). */
+static void SocketEventsEpoll(benchmark::Bench& bench)
+{
+    LoopbackPeers peers;
+    EpollSocketEvents epoll;
+    assert(epoll.IsValid());
+    for (size_t i = 0; i < peers.local.size(); ++i) {
+        assert(epoll.Add(peers.local[i], i, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET));
+    }
+    std::vector<struct epoll_event> events(256);
+    bench.unit("round").run([&] {
+        peers.SendToActive();
+
+        size_t ready = 0;
+        while (ready < ACTIVE_PEERS) {
+            const int num_events = epoll.Wait(events.data(), events.size(), WAIT_TIMEOUT_MILLISECONDS);
+            assert(num_events >= 0);
+            for (int i = 0; i < num_events; ++i) {
+                if ((events[i].events & EPOLLIN) && LoopbackPeers::Drain(peers.local[events[i].data.u64])) ++ready;
+            }
+        }
+    });
+}
+
+BENCHMARK(SocketEventsPoll);
+BENCHMARK(SocketEventsEpoll);
+
+#endif // USE_EPOLL
@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 #include <key.h>
+#include <pubkey.h>
 #if defined(HAVE_CONSENSUS_LIB)
 #include <script/bitcoinconsensus.h>
 #endif
@@ -11,6 +12,7 @@
 #include <script/standard.h>
 #include <streams.h>
 #include <test/util/transaction_utils.h>
+#include <util/strencodings.h>
 
 #include <array>
 
@@ -96,5 +98,51 @@ static void VerifyNestedIfScript(benchmark::Bench& bench)
     });
 }
 
+// Valid BIP340 test vectors: public key, message, signature
+static const std::array<std::array<const char*, 3>, 4> BIP340_VECTORS{{
+    {{"F9308A019258C31049344F85F89D5229B531C845836F99B08601F113BCE036F9", "0000000000000000000000000000000000000000000000000000000000000000", "E907831F80848D1069A5371B402410364BDF1C5F8307B0084C55F1CE2DCA821525F66A4A85EA8B71E482A74F382D2CE5EBEEE8FDB2172F477DF4900D310536C0"}},
+    {{"DFF1D77F2A671C5F36183726DB2341BE58FEAE1DA2DECED843240F7B502BA659", "243F6A8885A308D313198A2E03707344A4093822299F31D0082EFA98EC4E6C89", "6896BD60EEAE296DB48A229FF71DFE071BDE413E6D43F917DC8DCF8C78DE33418906D11AC976ABCCB20B091292BFF4EA897EFCB639EA871CFA95F6DE339E4B0A"}},
+    {{"DD308AFEC5777E13121FA72B9CC1B7CC0139715309B086C960E18FD969774EB8", "7E2D58D8B3BCDF1ABADEC7829054F90DDA9805AAB56C77333024B9D0A508B75C", "5831AAEED7B44BB74E5EAB94BA9D4294C49BCF2A60728D8B4C200F50DD313C1BAB745879A5AD954A72C45A91C3A51D3C7ADEA98D82F8481E0E1E03674A6F3FB7"}},
+    {{"25D1DFF95105F5253C4022F628A996AD3A0D95FBF21D468A1B33F8C160D8F517", "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF", "7EB0509757E246F19449885651611CB965ECC1A187DD51B64FDA1EDC9637D5EC97582B9CB13DB3933705B32BA982AF5AF25FD78881EBB32771FC5922EFC66EA3"}},
+}};
+
+// Verification of the 100 Schnorr signatures of a Taproot-heavy block, one
+// by one or as a batch.
+static void VerifySchnorrSignatures(benchmark::Bench& bench, bool batched)
+{
+    const ECCVerifyHandle verify_handle;
+    ECC_Start();
+
+    std::vector<XOnlyPubKey> pubkeys;
+    std::vector<uint256> msgs;
+    std::vector<std::vector<unsigned char>> sigs;
+    for (int i = 0; i < 100; ++i) {
+        const auto& vector = BIP340_VECTORS[i % BIP340_VECTORS.size()];
+        pubkeys.emplace_back(ParseHex(vector[0]));
+        msgs.emplace_back(ParseHex(vector[1]));
+        sigs.push_back(ParseHex(vector[2]));
+    }
+
+    SchnorrSignatureBatch batch;
+    bench.batch(sigs.size()).unit("signature").run([&] {
+        bool ok = true;
+        for (size_t i = 0; i < sigs.size(); ++i) {
+            if (batched) {
+                batch.Add(sigs[i], pubkeys[i], msgs[i]);
+            } else {
+                ok = pubkeys[i].VerifySchnorr(msgs[i], sigs[i]) && ok;
+            }
+        }
+        if (batched) ok = batch.Verify();
+        assert(ok);
+    });
+    ECC_Stop();
+}
+
+static void VerifySchnorrIndividually(benchmark::Bench& bench) { VerifySchnorrSignatures(bench, false); }
+static void VerifySchnorrBatch(benchmark::Bench& bench) { VerifySchnorrSignatures(bench, true); }
+
 BENCHMARK(VerifyScriptBench);
+BENCHMARK(VerifySchnorrIndividually);
+BENCHMARK(VerifySchnorrBatch);
 BENCHMARK(VerifyNestedIfScript);
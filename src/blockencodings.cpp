@@ -14,8 +14,12 @@
 #include <validation.h>
 #include <util/system.h>
 
+#include <algorithm>
 #include <unordered_map>
 
+//! Number of short IDs computed at a time while scanning the mempool
+static constexpr size_t SHORTID_BATCH = 64;
+
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID) :
         nonce(GetRand(std::numeric_limits<uint64_t>::max())), header(block), mweb_block(block.mweb_block) {
     FillShortTxIDSelector();
@@ -27,13 +31,16 @@ CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool f
         prefilledtxn.push_back({(uint16_t)(block.vtx.size() - 2), block.vtx.back()});
     }
 
-    shorttxids.reserve(block.vtx.size() - 1);
+    std::vector<const uint256*> txhashes;
+    txhashes.reserve(block.vtx.size() - 1);
     for (size_t i = 1; i < block.vtx.size(); i++) {
         const CTransaction& tx = *block.vtx[i];
         if (!tx.IsHogEx()) {
-            shorttxids.push_back(GetShortID(fUseWTXID ? tx.GetWitnessHash() : tx.GetHash()));
+            txhashes.push_back(fUseWTXID ? &tx.GetWitnessHash() : &tx.GetHash());
         }
     }
+    shorttxids.resize(txhashes.size());
+    GetShortIDs(txhashes.data(), txhashes.size(), shorttxids.data());
 }
 
 void CBlockHeaderAndShortTxIDs::FillShortTxIDSelector() const {
@@ -52,6 +59,13 @@ uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& txhash) const {
     return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & 0xffffffffffffL;
 }
 
+void CBlockHeaderAndShortTxIDs::GetShortIDs(const uint256* const* txhashes, size_t count, uint64_t* out) const {
+    SipHashUint256Batch(shorttxidk0, shorttxidk1, txhashes, count, out);
+    for (size_t i = 0; i < count; i++) {
+        out[i] &= 0xffffffffffffL;
+    }
+}
+
 
 
 ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn) {
@@ -113,10 +127,19 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
         return READ_STATUS_FAILED; // Short ID collision
 
     std::vector<bool> have_txn(txn_available.size());
+    const uint256* txhashes[SHORTID_BATCH];
+    uint64_t shortids[SHORTID_BATCH];
     {
     LOCK(pool->cs);
     for (size_t i = 0; i < pool->vTxHashes.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(pool->vTxHashes[i].first);
+        if (i % SHORTID_BATCH == 0) {
+            const size_t count = std::min(SHORTID_BATCH, pool->vTxHashes.size() - i);
+            for (size_t j = 0; j < count; j++) {
+                txhashes[j] = &pool->vTxHashes[i + j].first;
+            }
+            cmpctblock.GetShortIDs(txhashes, count, shortids);
+        }
+        uint64_t shortid = shortids[i % SHORTID_BATCH];
         std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
         if (idit != shorttxids.end()) {
             if (!have_txn[idit->second]) {
@@ -142,7 +165,14 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     }
 
     for (size_t i = 0; i < extra_txn.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(extra_txn[i].first);
+        if (i % SHORTID_BATCH == 0) {
+            const size_t count = std::min(SHORTID_BATCH, extra_txn.size() - i);
+            for (size_t j = 0; j < count; j++) {
+                txhashes[j] = &extra_txn[i + j].first;
+            }
+            cmpctblock.GetShortIDs(txhashes, count, shortids);
+        }
+        uint64_t shortid = shortids[i % SHORTID_BATCH];
         std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
         if (idit != shorttxids.end()) {
             if (!have_txn[idit->second]) {
@@ -114,6 +114,8 @@ public:
     CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID);
 
     uint64_t GetShortID(const uint256& txhash) const;
+    /** Compute the short IDs of `count` transaction hashes at once into `out` */
+    void GetShortIDs(const uint256* const* txhashes, size_t count, uint64_t* out) const;
 
     size_t BlockTxCount() const { return shorttxids.size() + prefilledtxn.size(); }
 
@@ -2,11 +2,13 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <array>
 #include <mutex>
 #include <sstream>
 #include <set>
 
 #include <blockfilter.h>
+#include <crypto/common.h>
 #include <crypto/siphash.h>
 #include <hash.h>
 #include <primitives/transaction.h>
@@ -55,6 +57,42 @@ static uint64_t MapIntoRange(uint64_t x, uint64_t n)
 #endif
 }
 
+/// Number of bits sorted on per pass of RadixSort().
+static constexpr int RADIX_BITS = 11;
+
+/// Below this number of values, RadixSort() uses std::sort.
+static constexpr size_t RADIX_SORT_MIN_SIZE = 256;
+
+// Sort values which are all less than `range`. Larger sets are sorted with a
+// least significant digit radix sort, which only needs as many passes as
+// there are digits in range - 1.
+static void RadixSort(std::vector<uint64_t>& values, uint64_t range)
+{
+    if (values.size() < RADIX_SORT_MIN_SIZE) {
+        std::sort(values.begin(), values.end());
+        return;
+    }
+
+    const int bits = CountBits(range > 0 ? range - 1 : 0);
+    std::vector<uint64_t> sorted(values.size());
+    for (int shift = 0; shift < bits; shift += RADIX_BITS) {
+        std::array<size_t, 1 << RADIX_BITS> offsets{};
+        for (uint64_t value : values) {
+            ++offsets[(value >> shift) & ((1 << RADIX_BITS) - 1)];
+        }
+        size_t offset = 0;
+        for (size_t& count : offsets) {
+            const size_t next = offset + count;
+            count = offset;
+            offset = next;
+        }
+        for (uint64_t value : values) {
+            sorted[offsets[(value >> shift) & ((1 << RADIX_BITS) - 1)]++] = value;
+        }
+        values.swap(sorted);
+    }
+}
+
 uint64_t GCSFilter::HashToRange(const Element& element) const
 {
     uint64_t hash = CSipHasher(m_params.m_siphash_k0, m_params.m_siphash_k1)
@@ -65,12 +103,14 @@ uint64_t GCSFilter::HashToRange(const Element& element) const
 
 std::vector<uint64_t> GCSFilter::BuildHashedSet(const ElementSet& elements) const
 {
+    // Set up the keyed hasher once, rather than for each element
+    const CSipHasher hasher(m_params.m_siphash_k0, m_params.m_siphash_k1);
     std::vector<uint64_t> hashed_elements;
     hashed_elements.reserve(elements.size());
     for (const Element& element : elements) {
-        hashed_elements.push_back(HashToRange(element));
+        hashed_elements.push_back(MapIntoRange(CSipHasher(hasher).Write(element.data(), element.size()).Finalize(), m_F));
     }
-    std::sort(hashed_elements.begin(), hashed_elements.end());
+    RadixSort(hashed_elements, m_F);
     return hashed_elements;
 }
 
@@ -92,11 +132,11 @@ GCSFilter::GCSFilter(const Params& params, std::vector<unsigned char> encoded_fi
 
     // Verify that the encoded filter contains exactly N elements. If it has too much or too little
     // data, a std::ios_base::failure exception will be raised.
-    BitStreamReader<VectorReader> bitreader(stream);
+    GolombRiceReader reader(Span<const unsigned char>(m_encoded).subspan(GetSizeOfCompactSize(N)), m_params.m_P);
     for (uint64_t i = 0; i < m_N; ++i) {
-        GolombRiceDecode(bitreader, m_params.m_P);
+        reader.Decode();
     }
-    if (!stream.empty()) {
+    if (reader.BytesLeft() != 0) {
         throw std::ios_base::failure("encoded_filter contains excess data");
     }
 }
@@ -119,32 +159,32 @@ GCSFilter::GCSFilter(const Params& params, const ElementSet& elements)
         return;
     }
 
-    BitStreamWriter<CVectorWriter> bitwriter(stream);
+    GolombRiceWriter writer(m_encoded, m_params.m_P);
 
     uint64_t last_value = 0;
     for (uint64_t value : BuildHashedSet(elements)) {
         uint64_t delta = value - last_value;
-        GolombRiceEncode(bitwriter, m_params.m_P, delta);
+        writer.Encode(delta);
         last_value = value;
     }
 
-    bitwriter.Flush();
+    writer.Flush();
 }
 
-bool GCSFilter::MatchInternal(const uint64_t* element_hashes, size_t size) const
+GolombRiceReader GCSFilter::GetReader() const
 {
-    VectorReader stream(GCS_SER_TYPE, GCS_SER_VERSION, m_encoded, 0);
-
-    // Seek forward by size of N
-    uint64_t N = ReadCompactSize(stream);
-    assert(N == m_N);
+    // Skip N
+    return GolombRiceReader(Span<const unsigned char>(m_encoded).subspan(GetSizeOfCompactSize(m_N)), m_params.m_P);
+}
 
-    BitStreamReader<VectorReader> bitreader(stream);
+bool GCSFilter::MatchInternal(const uint64_t* element_hashes, size_t size) const
+{
+    GolombRiceReader reader = GetReader();
 
     uint64_t value = 0;
     size_t hashes_index = 0;
     for (uint32_t i = 0; i < m_N; ++i) {
-        uint64_t delta = GolombRiceDecode(bitreader, m_params.m_P);
+        uint64_t delta = reader.Decode();
         value += delta;
 
         while (true) {
@@ -175,6 +215,31 @@ bool GCSFilter::MatchAny(const ElementSet& elements) const
     return MatchInternal(queries.data(), queries.size());
 }
 
+std::vector<bool> GCSFilter::MatchAny(const std::vector<ElementSet>& element_sets) const
+{
+    std::vector<bool> matches(element_sets.size(), false);
+
+    // Hashes of the elements of all sets, each along with the index of its set
+    std::vector<std::pair<uint64_t, size_t>> queries;
+    for (size_t i = 0; i < element_sets.size(); ++i) {
+        for (uint64_t hash : BuildHashedSet(element_sets[i])) {
+            queries.emplace_back(hash, i);
+        }
+    }
+    std::sort(queries.begin(), queries.end());
+
+    GolombRiceReader reader = GetReader();
+    uint64_t value = 0;
+    auto query = queries.begin();
+    for (uint32_t i = 0; i < m_N && query != queries.end(); ++i) {
+        value += reader.Decode();
+        for (; query != queries.end() && query->first <= value; ++query) {
+            if (query->first == value) matches[query->second] = true;
+        }
+    }
+    return matches;
+}
+
 const std::string& BlockFilterTypeName(BlockFilterType filter_type)
 {
     static std::string unknown_retval = "";
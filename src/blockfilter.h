@@ -17,6 +17,8 @@
 #include <undo.h>
 #include <util/bytevectorhash.h>
 
+class GolombRiceReader;
+
 /**
  * This implements a Golomb-coded set as defined in BIP 158. It is a
  * compact, probabilistic data structure for testing set membership.
@@ -50,6 +52,9 @@ private:
 
     std::vector<uint64_t> BuildHashedSet(const ElementSet& elements) const;
 
+    /** Decoder of the element hashes, starting at the first */
+    GolombRiceReader GetReader() const;
+
     /** Helper method used to implement Match and MatchAny */
     bool MatchInternal(const uint64_t* sorted_element_hashes, size_t size) const;
 
@@ -80,6 +85,13 @@ public:
      * efficient that checking Match on multiple elements separately.
      */
     bool MatchAny(const ElementSet& elements) const;
+
+    /**
+     * Checks, for each of the given sets of elements, if any of its elements
+     * may be in the set, like MatchAny() does. The filter is only decoded
+     * once for all of them, such as the sets of different wallets.
+     */
+    std::vector<bool> MatchAny(const std::vector<ElementSet>& element_sets) const;
 };
 
 constexpr uint8_t BASIC_FILTER_P = 19;
@@ -6,8 +6,13 @@
 #define BITCOIN_CHECKQUEUE_H
 
 #include <sync.h>
+#include <util/memory.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -16,6 +21,17 @@
 template <typename T>
 class CCheckQueueControl;
 
+/**
+ * Runs checks for one worker of a CCheckQueue. Specializations may defer part
+ * of each check, and complete it in Finish() for every batch of checks the
+ * worker takes from the queue.
+ */
+template <typename T>
+struct CCheckBatch {
+    bool Run(T& check) { return check(); }
+    bool Finish(bool fOk) { return fOk; }
+};
+
 /**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -25,12 +41,32 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every worker owns a deque of checks, and each batch passed to Add() is
+  * queued as a whole on one worker's deque, so that the checks of one
+  * transaction are usually run by the same thread. Workers take checks from
+  * the back of their own deque, and steal from the front of other deques
+  * when theirs is empty. Each deque has its own lock, and progress is
+  * tracked with atomic counters, so workers only contend when they touch
+  * the same deque. The queue-wide mutex is only taken to put idle threads
+  * to sleep and to wake them up.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! A deque of checks, owned by one or more workers
+    struct Slot {
+        Mutex mutex;
+        std::deque<T> checks GUARDED_BY(mutex);
+        //! Size of checks, readable without the lock
+        std::atomic<size_t> size{0};
+    };
+
+    //! Slot 0 is used by the master, the others are shared round-robin by the worker threads.
+    const std::vector<std::unique_ptr<Slot>> m_slots;
+
+    //! Mutex to put idle threads to sleep
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,86 +75,148 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! The number of worker threads that ever called Thread(), which assigns their slot.
+    std::atomic<int> nWorkers{0};
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! The number of workers that are idle.
+    std::atomic<int> nIdle{0};
 
     //! The total number of workers (including the master).
-    int nTotal;
+    std::atomic<int> nTotal{0};
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk{true};
+
+    //! Number of checks in the slots, not yet taken by any worker.
+    std::atomic<size_t> nQueued{0};
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<size_t> nTodo{0};
 
     //! The maximum number of elements to be processed in one batch
-    unsigned int nBatchSize;
+    const unsigned int nBatchSize;
+
+    //! Slot the next batch is added to (only used by the master)
+    unsigned int nNextSlot{0};
+
+    static std::vector<std::unique_ptr<Slot>> MakeSlots()
+    {
+        std::vector<std::unique_ptr<Slot>> slots(std::max(2U, std::thread::hardware_concurrency() + 1));
+        for (auto& slot : slots) {
+            slot = MakeUnique<Slot>();
+        }
+        return slots;
+    }
+
+    /**
+     * Decide how many of the `available` checks to take now.
+     * * Do not try to do everything at once, but aim for increasingly smaller batches so
+     *   all workers finish approximately simultaneously.
+     * * Try to account for idle jobs which will instantly start helping.
+     * * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
+     */
+    size_t BatchSize(size_t available) const
+    {
+        const size_t share = nQueued.load(std::memory_order_relaxed) / (nTotal.load(std::memory_order_relaxed) + nIdle.load(std::memory_order_relaxed) + 1);
+        return std::max<size_t>(1, std::min<size_t>({nBatchSize, available, share}));
+    }
+
+    /** Move a batch of checks from the back of a slot (or the front, when stealing) into vChecks. */
+    bool TakeFrom(Slot& slot, bool steal, std::vector<T>& vChecks)
+    {
+        if (slot.size.load(std::memory_order_relaxed) == 0) return false;
+        LOCK(slot.mutex);
+        if (slot.checks.empty()) return false;
+        // A thief takes at most half of the slot, leaving the rest to its owner.
+        const size_t nNow = BatchSize(steal ? (slot.checks.size() + 1) / 2 : slot.checks.size());
+        vChecks.resize(nNow);
+        for (size_t i = 0; i < nNow; i++) {
+            // Swap jobs from the slot to the local batch vector instead of copying.
+            if (steal) {
+                vChecks[i].swap(slot.checks.front());
+                slot.checks.pop_front();
+            } else {
+                vChecks[i].swap(slot.checks.back());
+                slot.checks.pop_back();
+            }
+        }
+        slot.size.store(slot.checks.size(), std::memory_order_relaxed);
+        nQueued -= nNow;
+        return true;
+    }
+
+    /** Take a batch from our own slot, or steal one from another slot. */
+    bool TakeChecks(size_t own, std::vector<T>& vChecks)
+    {
+        if (TakeFrom(*m_slots[own], false, vChecks)) return true;
+        for (size_t i = 1; i < m_slots.size(); i++) {
+            if (nQueued.load() == 0) return false;
+            if (TakeFrom(*m_slots[(own + i) % m_slots.size()], true, vChecks)) return true;
+        }
+        return false;
+    }
+
+    /** Run a batch, and mark it as done once all its checks are destroyed. */
+    void RunChecks(std::vector<T>& vChecks, CCheckBatch<T>& batch)
+    {
+        // Check whether we need to do work at all
+        bool fOk = fAllOk.load(std::memory_order_relaxed);
+        for (T& check : vChecks)
+            if (fOk)
+                fOk = batch.Run(check);
+        // Complete any deferred work before the checks count as done
+        fOk = batch.Finish(fOk);
+        if (!fOk) fAllOk = false;
+        const size_t nNow = vChecks.size();
+        vChecks.clear();
+        if (nTodo.fetch_sub(nNow) == nNow) {
+            // We processed the last element; inform the master it can exit and return the result
+            boost::unique_lock<boost::mutex> lock(mutex);
+            condMaster.notify_one();
+        }
+    }
 
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+        const size_t own = fMaster ? 0 : 1 + nWorkers++ % (m_slots.size() - 1);
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
+        CCheckBatch<T> batch;
+        nTotal++;
         do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
+            if (TakeChecks(own, vChecks)) {
+                RunChecks(vChecks, batch);
+                continue;
+            }
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fMaster) {
+                if (nTodo == 0) {
+                    nTotal--;
+                    // return the current status, and reset it for new work later
+                    return fAllOk.exchange(true);
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
+                // Wait for the workers to finish their batches, unless there is more to steal.
+                if (nQueued == 0) condMaster.wait(lock);
+                continue;
+            }
+            // Add() only wakes us up if it sees nIdle > 0, so count ourselves
+            // as idle before the final check for queued work.
+            nIdle++;
+            try {
+                while (nQueued == 0) {
+                    condWorker.wait(lock); // wait
                 }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+            } catch (...) {
+                nIdle--;
+                nTotal--;
+                throw;
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
+            nIdle--;
         } while (true);
     }
 
@@ -127,7 +225,7 @@ public:
     boost::mutex ControlMutex;
 
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
+    explicit CCheckQueue(unsigned int nBatchSizeIn) : m_slots(MakeSlots()), nBatchSize(nBatchSizeIn) {}
 
     //! Worker thread
     void Thread()
@@ -144,16 +242,28 @@ public:
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty()) return;
+        // Queue the whole batch on the slot of one worker, or on the master's
+        // slot if there are no workers.
+        const size_t nSlots = std::min<size_t>(nWorkers.load(), m_slots.size() - 1);
+        Slot& slot = nSlots == 0 ? *m_slots[0] : *m_slots[1 + nNextSlot++ % nSlots];
         nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
-            condWorker.notify_all();
+        {
+            LOCK(slot.mutex);
+            for (T& check : vChecks) {
+                slot.checks.emplace_back();
+                check.swap(slot.checks.back());
+            }
+            slot.size.store(slot.checks.size(), std::memory_order_relaxed);
+            nQueued += vChecks.size();
+        }
+        if (nIdle.load() > 0) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (vChecks.size() == 1)
+                condWorker.notify_one();
+            else
+                condWorker.notify_all();
+        }
     }
 
     ~CCheckQueue()
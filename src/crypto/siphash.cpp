@@ -4,6 +4,8 @@
 
 #include <crypto/siphash.h>
 
+#include <crypto/common.h>
+
 #define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
 
 #define SIPROUND do { \
@@ -51,9 +53,22 @@ CSipHasher& CSipHasher::Write(const unsigned char* data, size_t size)
     uint64_t t = tmp;
     uint8_t c = count;
 
-    while (size--) {
+    while (size > 0) {
+        if ((c & 7) == 0 && size >= 8) {
+            // Whole words at once
+            const uint64_t m = ReadLE64(data);
+            v3 ^= m;
+            SIPROUND;
+            SIPROUND;
+            v0 ^= m;
+            data += 8;
+            size -= 8;
+            c += 8;
+            continue;
+        }
         t |= ((uint64_t)(*(data++))) << (8 * (c % 8));
         c++;
+        size--;
         if ((c & 7) == 0) {
             v3 ^= t;
             SIPROUND;
@@ -171,3 +186,95 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     SIPROUND;
     return v0 ^ v1 ^ v2 ^ v3;
 }
+
+namespace {
+
+/** Number of hashes computed side by side by the batch functions */
+constexpr size_t LANES = 4;
+
+/** The SipHash state of LANES hashes, laid out so that each step is a loop over the lanes. */
+struct SipHashLanes
+{
+    uint64_t v0[LANES], v1[LANES], v2[LANES], v3[LANES];
+
+    SipHashLanes(uint64_t k0, uint64_t k1)
+    {
+        for (size_t l = 0; l < LANES; ++l) {
+            v0[l] = 0x736f6d6570736575ULL ^ k0;
+            v1[l] = 0x646f72616e646f6dULL ^ k1;
+            v2[l] = 0x6c7967656e657261ULL ^ k0;
+            v3[l] = 0x7465646279746573ULL ^ k1;
+        }
+    }
+
+    void Round()
+    {
+        for (size_t l = 0; l < LANES; ++l) {
+            v0[l] += v1[l]; v1[l] = ROTL(v1[l], 13); v1[l] ^= v0[l];
+            v0[l] = ROTL(v0[l], 32);
+            v2[l] += v3[l]; v3[l] = ROTL(v3[l], 16); v3[l] ^= v2[l];
+            v0[l] += v3[l]; v3[l] = ROTL(v3[l], 21); v3[l] ^= v0[l];
+            v2[l] += v1[l]; v1[l] = ROTL(v1[l], 17); v1[l] ^= v2[l];
+            v2[l] = ROTL(v2[l], 32);
+        }
+    }
+
+    void Write(const uint64_t (&d)[LANES])
+    {
+        for (size_t l = 0; l < LANES; ++l) v3[l] ^= d[l];
+        Round();
+        Round();
+        for (size_t l = 0; l < LANES; ++l) v0[l] ^= d[l];
+    }
+
+    void WriteUint256(const uint256* const* vals)
+    {
+        uint64_t d[LANES];
+        for (int i = 0; i < 4; ++i) {
+            for (size_t l = 0; l < LANES; ++l) d[l] = vals[l]->GetUint64(i);
+            Write(d);
+        }
+    }
+
+    void Finalize(uint64_t* out)
+    {
+        for (size_t l = 0; l < LANES; ++l) v2[l] ^= 0xFF;
+        Round();
+        Round();
+        Round();
+        Round();
+        for (size_t l = 0; l < LANES; ++l) out[l] = v0[l] ^ v1[l] ^ v2[l] ^ v3[l];
+    }
+};
+
+} // namespace
+
+void SipHashUint256Batch(uint64_t k0, uint64_t k1, const uint256* const* vals, size_t count, uint64_t* out)
+{
+    for (; count >= LANES; vals += LANES, out += LANES, count -= LANES) {
+        SipHashLanes lanes(k0, k1);
+        lanes.WriteUint256(vals);
+        uint64_t d[LANES];
+        for (size_t l = 0; l < LANES; ++l) d[l] = ((uint64_t)4) << 59;
+        lanes.Write(d);
+        lanes.Finalize(out);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = SipHashUint256(k0, k1, *vals[i]);
+    }
+}
+
+void SipHashUint256ExtraBatch(uint64_t k0, uint64_t k1, const uint256* const* vals, const uint32_t* extra, size_t count, uint64_t* out)
+{
+    for (; count >= LANES; vals += LANES, extra += LANES, out += LANES, count -= LANES) {
+        SipHashLanes lanes(k0, k1);
+        lanes.WriteUint256(vals);
+        uint64_t d[LANES];
+        for (size_t l = 0; l < LANES; ++l) d[l] = (((uint64_t)36) << 56) | extra[l];
+        lanes.Write(d);
+        lanes.Finalize(out);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = SipHashUint256Extra(k0, k1, *vals[i], extra[i]);
+    }
+}
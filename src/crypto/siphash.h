@@ -5,6 +5,7 @@
 #ifndef BITCOIN_CRYPTO_SIPHASH_H
 #define BITCOIN_CRYPTO_SIPHASH_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <uint256.h>
@@ -44,4 +45,13 @@ public:
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
 
+/** Compute SipHashUint256(k0, k1, *vals[i]) into out[i] for i in [0, count).
+ *
+ *  Groups of values are hashed side by side, so that the rounds of different
+ *  hashes overlap instead of waiting on each other.
+ */
+void SipHashUint256Batch(uint64_t k0, uint64_t k1, const uint256* const* vals, size_t count, uint64_t* out);
+/** Compute SipHashUint256Extra(k0, k1, *vals[i], extra[i]) into out[i] for i in [0, count). */
+void SipHashUint256ExtraBatch(uint64_t k0, uint64_t k1, const uint256* const* vals, const uint32_t* extra, size_t count, uint64_t* out);
+
 #endif // BITCOIN_CRYPTO_SIPHASH_H
@@ -6,6 +6,9 @@
 
 #include <memory>
 #include <random.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/strencodings.h>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -13,6 +16,8 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <set>
+#include <sstream>
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -72,6 +77,113 @@ public:
     }
 };
 
+static Mutex g_db_mutex;
+//! Block cache shared by newly opened databases, if any
+static std::shared_ptr<leveldb::Cache> g_shared_block_cache GUARDED_BY(g_db_mutex);
+//! All open databases, for GetAllDBStats()
+static std::set<const CDBWrapper*> g_open_dbs GUARDED_BY(g_db_mutex);
+
+void SetSharedDBBlockCache(size_t bytes)
+{
+    LOCK(g_db_mutex);
+    if (bytes == 0) {
+        g_shared_block_cache.reset();
+    } else {
+        g_shared_block_cache.reset(leveldb::NewLRUCache(bytes));
+    }
+}
+
+static bool ParseDBTuningOption(const std::string& option, DBTuning& tuning, std::string& error)
+{
+    const size_t eq = option.find('=');
+    if (eq == std::string::npos) {
+        error = strprintf("Invalid -dbtuning option '%s', expected <option>=<value>", option);
+        return false;
+    }
+    const std::string key = option.substr(0, eq);
+    const std::string value = option.substr(eq + 1);
+    int32_t n;
+    if (key == "compression") {
+        if (value == "none") {
+            tuning.compression = leveldb::kNoCompression;
+        } else if (value == "snappy") {
+            tuning.compression = leveldb::kSnappyCompression;
+        } else {
+            error = strprintf("Unknown -dbtuning compression '%s' (none|snappy)", value);
+            return false;
+        }
+    } else if (key == "blocksize") {
+        if (!ParseInt32(value, &n) || n < 1 || n > 4096) {
+            error = strprintf("Invalid -dbtuning blocksize '%s' (1 to 4096 KiB)", value);
+            return false;
+        }
+        tuning.block_size = size_t(n) * 1024;
+    } else if (key == "bloombits") {
+        if (!ParseInt32(value, &n) || n < 0 || n > 64) {
+            error = strprintf("Invalid -dbtuning bloombits '%s' (0 to 64)", value);
+            return false;
+        }
+        tuning.bloom_bits = n;
+    } else if (key == "maxopenfiles") {
+        if (!ParseInt32(value, &n) || n < 0) {
+            error = strprintf("Invalid -dbtuning maxopenfiles '%s'", value);
+            return false;
+        }
+        tuning.max_open_files = n;
+    } else {
+        error = strprintf("Unknown -dbtuning option '%s' (compression|blocksize|bloombits|maxopenfiles)", key);
+        return false;
+    }
+    return true;
+}
+
+bool GetDBTuning(const ArgsManager& args, const std::string& name, DBTuning& tuning, std::string& error)
+{
+    const std::vector<std::string> values = args.GetArgs("-dbtuning");
+    // Apply the options for all databases first, so that database specific ones take precedence.
+    for (const bool specific : {false, true}) {
+        for (const std::string& value : values) {
+            const size_t colon = value.find(':');
+            if (colon == std::string::npos) {
+                error = strprintf("Invalid -dbtuning '%s', expected <db>:<option>=<value>", value);
+                return false;
+            }
+            const std::string db = value.substr(0, colon);
+            if (db != (specific ? name : "all")) continue;
+            if (!ParseDBTuningOption(value.substr(colon + 1), tuning, error)) return false;
+        }
+    }
+    return true;
+}
+
+bool CheckDBTuningArgs(const ArgsManager& args, std::string& error)
+{
+    for (const std::string& value : args.GetArgs("-dbtuning")) {
+        const size_t colon = value.find(':');
+        if (colon == std::string::npos) {
+            error = strprintf("Invalid -dbtuning '%s', expected <db>:<option>=<value>", value);
+            return false;
+        }
+        DBTuning tuning;
+        if (!ParseDBTuningOption(value.substr(colon + 1), tuning, error)) return false;
+    }
+    return true;
+}
+
+/**
+ * Name of the database at `path`, as used by -dbtuning and in statistics:
+ * its directory name, except for the block index ("blocks/index") and the
+ * block filter indexes ("indexes/blockfilter/<type>/db").
+ */
+static std::string GetDBName(const fs::path& path)
+{
+    const std::string name = path.stem().string();
+    const std::string parent = path.parent_path().stem().string();
+    if (name == "index" && parent == "blocks") return "blockindex";
+    if (name == "db" && path.parent_path().parent_path().stem().string() == "blockfilter") return "blockfilter_" + parent;
+    return name;
+}
+
 static void SetMaxOpenFiles(leveldb::Options *options) {
     // On most platforms the default setting of max_open_files (which is 1000)
     // is optimal. On Windows using a large file count is OK because the handles
@@ -97,13 +209,15 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+static leveldb::Options GetOptions(size_t nCacheSize, const DBTuning& tuning, leveldb::Cache* block_cache)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
+    options.block_cache = block_cache;
     options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
+    options.block_size = tuning.block_size;
+    options.filter_policy = tuning.bloom_bits > 0 ? leveldb::NewBloomFilterPolicy(tuning.bloom_bits) : nullptr;
+    // Without Snappy support compiled into LevelDB, blocks are stored uncompressed.
+    options.compression = tuning.compression;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -111,18 +225,29 @@ static leveldb::Options GetOptions(size_t nCacheSize)
         options.paranoid_checks = true;
     }
     SetMaxOpenFiles(&options);
+    if (tuning.max_open_files > 0) {
+        options.max_open_files = tuning.max_open_files;
+    }
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
-    : m_name{path.stem().string()}
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, const DBTuning& tuning)
+    : m_name{GetDBName(path)}, m_tuning{tuning}
 {
     penv = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    {
+        LOCK(g_db_mutex);
+        m_block_cache = g_shared_block_cache;
+    }
+    m_shared_block_cache = m_block_cache != nullptr;
+    if (!m_shared_block_cache) {
+        m_block_cache.reset(leveldb::NewLRUCache(nCacheSize / 2));
+    }
+    options = GetOptions(nCacheSize, m_tuning, m_block_cache.get());
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -164,18 +289,25 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     }
 
     LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
+
+    LOCK(g_db_mutex);
+    g_open_dbs.insert(this);
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        LOCK(g_db_mutex);
+        g_open_dbs.erase(this);
+    }
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
     options.filter_policy = nullptr;
     delete options.info_log;
     options.info_log = nullptr;
-    delete options.block_cache;
     options.block_cache = nullptr;
+    m_block_cache.reset();
     delete penv;
     options.env = nullptr;
 }
@@ -189,6 +321,8 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     }
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
+    m_batches.fetch_add(1, std::memory_order_relaxed);
+    m_write_bytes.fetch_add(batch.SizeEstimate(), std::memory_order_relaxed);
     if (log_memory) {
         double mem_after = DynamicMemoryUsage() / 1024.0 / 1024;
         LogPrint(BCLog::LEVELDB, "WriteBatch memory usage: db=%s, before=%.1fMiB, after=%.1fMiB\n",
@@ -206,6 +340,48 @@ size_t CDBWrapper::DynamicMemoryUsage() const {
     return stoul(memory);
 }
 
+DBStats CDBWrapper::GetStats() const
+{
+    DBStats stats;
+    stats.name = m_name;
+    stats.reads = m_reads.load(std::memory_order_relaxed);
+    stats.read_misses = m_read_misses.load(std::memory_order_relaxed);
+    stats.read_bytes = m_read_bytes.load(std::memory_order_relaxed);
+    stats.batches = m_batches.load(std::memory_order_relaxed);
+    stats.write_bytes = m_write_bytes.load(std::memory_order_relaxed);
+    stats.memory_usage = DynamicMemoryUsage();
+    stats.block_cache_usage = m_block_cache->TotalCharge();
+    stats.shared_block_cache = m_shared_block_cache;
+    stats.tuning = m_tuning;
+
+    // The "leveldb.stats" property is a table with a line per level:
+    // level, files, size (MB), compaction time (s), compaction read (MB) and write (MB).
+    std::string table;
+    if (pdb->GetProperty("leveldb.stats", &table)) {
+        std::istringstream lines(table);
+        std::string line;
+        while (std::getline(lines, line)) {
+            std::istringstream fields(line);
+            DBLevelStats level;
+            if (fields >> level.level >> level.files >> level.size_mb >> level.compaction_sec >> level.compaction_read_mb >> level.compaction_write_mb) {
+                stats.levels.push_back(level);
+            }
+        }
+    }
+    return stats;
+}
+
+std::vector<DBStats> GetAllDBStats()
+{
+    std::vector<DBStats> stats;
+    LOCK(g_db_mutex);
+    for (const CDBWrapper* db : g_open_dbs) {
+        stats.push_back(db->GetStats());
+    }
+    std::sort(stats.begin(), stats.end(), [](const DBStats& a, const DBStats& b) { return a.name < b.name; });
+    return stats;
+}
+
 // Prefixed with null character to avoid collisions with other keys
 //
 // We must use a string constructor which specifies length so that we copy
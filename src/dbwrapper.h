@@ -15,9 +15,73 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <atomic>
+#include <memory>
+
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
+/** Tuning of one LevelDB database, see -dbtuning */
+struct DBTuning {
+    leveldb::CompressionType compression{leveldb::kNoCompression};
+    //! Approximate size of uncompressed data per table block
+    size_t block_size{4 * 1024};
+    //! Bits per key of the table bloom filters, 0 for none
+    int bloom_bits{10};
+    //! Maximum number of open table files, 0 for the LevelDB default
+    int max_open_files{0};
+};
+
+/**
+ * Parse the -dbtuning arguments that apply to database `name` into
+ * `tuning`, which holds the defaults. Options given for "all" apply to every
+ * database, and are overridden by options given for `name` itself.
+ */
+bool GetDBTuning(const ArgsManager& args, const std::string& name, DBTuning& tuning, std::string& error);
+
+/** Check the syntax of all -dbtuning arguments. */
+bool CheckDBTuningArgs(const ArgsManager& args, std::string& error);
+
+/**
+ * Have databases opened from now on share one LevelDB block cache of
+ * `bytes` bytes, or give each its own (of half its cache size) if 0.
+ * Databases keep the cache they were opened with.
+ */
+void SetSharedDBBlockCache(size_t bytes);
+
+/** Compaction statistics of one LevelDB level */
+struct DBLevelStats {
+    int level{0};
+    int64_t files{0};
+    double size_mb{0};
+    double compaction_sec{0};
+    double compaction_read_mb{0};
+    double compaction_write_mb{0};
+};
+
+/** Statistics of a database, see CDBWrapper::GetStats() */
+struct DBStats {
+    std::string name;
+    //! Point lookups (Read() and Exists() calls), and those that found nothing
+    uint64_t reads{0};
+    uint64_t read_misses{0};
+    //! Value bytes returned by Read()
+    uint64_t read_bytes{0};
+    //! Batches written, and their approximate size
+    uint64_t batches{0};
+    uint64_t write_bytes{0};
+    //! Levels with files or compactions
+    std::vector<DBLevelStats> levels;
+    size_t memory_usage{0};
+    //! Memory used by the block cache, which may be shared with other databases
+    size_t block_cache_usage{0};
+    bool shared_block_cache{false};
+    DBTuning tuning;
+};
+
+/** Return the statistics of all open databases. */
+std::vector<DBStats> GetAllDBStats();
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -200,6 +264,20 @@ private:
     //! the name of this database
     std::string m_name;
 
+    //! the tuning this database was opened with
+    DBTuning m_tuning;
+
+    //! the block cache of this database, possibly shared with other databases
+    std::shared_ptr<leveldb::Cache> m_block_cache;
+    bool m_shared_block_cache{false};
+
+    //! statistics counters, see GetStats()
+    mutable std::atomic<uint64_t> m_reads{0};
+    mutable std::atomic<uint64_t> m_read_misses{0};
+    mutable std::atomic<uint64_t> m_read_bytes{0};
+    std::atomic<uint64_t> m_batches{0};
+    std::atomic<uint64_t> m_write_bytes{0};
+
     //! a key used for optional XOR-obfuscation of the database
     std::vector<unsigned char> obfuscate_key;
 
@@ -219,8 +297,9 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] tuning      LevelDB options to open the database with, see GetDBTuning().
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, const DBTuning& tuning = {});
     ~CDBWrapper();
 
     CDBWrapper(const CDBWrapper&) = delete;
@@ -235,13 +314,17 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
+        m_reads.fetch_add(1, std::memory_order_relaxed);
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
         if (!status.ok()) {
-            if (status.IsNotFound())
+            if (status.IsNotFound()) {
+                m_read_misses.fetch_add(1, std::memory_order_relaxed);
                 return false;
+            }
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
+        m_read_bytes.fetch_add(strValue.size(), std::memory_order_relaxed);
         try {
             CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
             ssValue.Xor(obfuscate_key);
@@ -269,10 +352,13 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
+        m_reads.fetch_add(1, std::memory_order_relaxed);
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
         if (!status.ok()) {
-            if (status.IsNotFound())
+            if (status.IsNotFound()) {
+                m_read_misses.fetch_add(1, std::memory_order_relaxed);
                 return false;
+            }
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
@@ -292,6 +378,9 @@ public:
     // Get an estimate of LevelDB memory usage (in bytes).
     size_t DynamicMemoryUsage() const;
 
+    //! Get the read, write and compaction statistics of this database.
+    DBStats GetStats() const;
+
     CDBIterator *NewIterator()
     {
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
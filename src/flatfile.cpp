@@ -3,6 +3,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
 #include <stdexcept>
 
 #include <flatfile.h>
@@ -10,6 +14,13 @@
 #include <tinyformat.h>
 #include <util/system.h>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 FlatFileSeq::FlatFileSeq(fs::path dir, const char* prefix, size_t chunk_size) :
     m_dir(std::move(dir)),
     m_prefix(prefix),
@@ -96,3 +107,107 @@ bool FlatFileSeq::Flush(const FlatFilePos& pos, bool finalize)
     fclose(file);
     return true;
 }
+
+MappedFlatFile::~MappedFlatFile()
+{
+#ifndef WIN32
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+}
+
+Span<const uint8_t> MappedFlatFile::Data(unsigned int pos, size_t len) const
+{
+    assert(pos <= m_size && len <= m_size - pos);
+    return {m_data + pos, len};
+}
+
+void MappedFlatFile::WillNeed(unsigned int pos, size_t len) const
+{
+#ifndef WIN32
+    if (pos >= m_size) return;
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t begin = pos - pos % page_size;
+    const size_t end = std::min(m_size, size_t{pos} + len);
+    posix_madvise(const_cast<uint8_t*>(m_data) + begin, end - begin, POSIX_MADV_WILLNEED);
+#endif
+}
+
+static std::shared_ptr<const MappedFlatFile> MapFile(const fs::path& path)
+{
+#ifndef WIN32
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) return nullptr;
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        // Shared, so that data written to the file later is visible
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        LogPrint(BCLog::BENCH, "Unable to map file %s\n", path.string());
+        return nullptr;
+    }
+    return std::make_shared<const MappedFlatFile>(static_cast<const uint8_t*>(data), st.st_size);
+#else
+    return nullptr;
+#endif
+}
+
+std::shared_ptr<const MappedFlatFile> FlatFileMapCache::Map(const FlatFileSeq& seq, const FlatFilePos& pos, size_t len)
+{
+    if (pos.IsNull()) return nullptr;
+    const fs::path path = seq.FileName(pos);
+    const auto covers = [&](const MappedFlatFile& file) { return pos.nPos <= file.Size() && len <= file.Size() - pos.nPos; };
+
+    LOCK(m_mutex);
+    if (m_max_files == 0) return nullptr;
+    for (auto it = m_files.begin(); it != m_files.end(); ++it) {
+        if (it->first != path) continue;
+        if (!covers(*it->second)) {
+            // The file may have grown since it was mapped
+            m_files.erase(it);
+            break;
+        }
+        m_files.splice(m_files.begin(), m_files, it);
+        return it->second;
+    }
+
+    std::shared_ptr<const MappedFlatFile> file = MapFile(path);
+    if (!file) return nullptr;
+    m_files.emplace_front(path, file);
+    if (m_files.size() > m_max_files) m_files.pop_back();
+    if (!covers(*file)) return nullptr;
+    return file;
+}
+
+void FlatFileMapCache::RemoveFile(const fs::path& path)
+{
+    AssertLockHeld(m_mutex);
+    m_files.remove_if([&](const std::pair<fs::path, std::shared_ptr<const MappedFlatFile>>& entry) { return entry.first == path; });
+}
+
+bool FlatFileMapCache::Flush(FlatFileSeq seq, const FlatFilePos& pos, bool finalize)
+{
+    if (!finalize) return seq.Flush(pos);
+    // Hold the lock until the file is truncated, so that it is not mapped
+    // again in between
+    LOCK(m_mutex);
+    RemoveFile(seq.FileName(pos));
+    return seq.Flush(pos, true);
+}
+
+void FlatFileMapCache::Delete(const FlatFileSeq& seq, const FlatFilePos& pos)
+{
+    const fs::path path = seq.FileName(pos);
+    LOCK(m_mutex);
+    RemoveFile(path);
+    fs::remove(path);
+}
+
+void FlatFileMapCache::SetMaxFiles(size_t max_files)
+{
+    LOCK(m_mutex);
+    m_max_files = max_files;
+    while (m_files.size() > m_max_files) m_files.pop_back();
+}
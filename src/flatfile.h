@@ -6,10 +6,14 @@
 #ifndef BITCOIN_FLATFILE_H
 #define BITCOIN_FLATFILE_H
 
+#include <list>
+#include <memory>
 #include <string>
 
 #include <fs.h>
 #include <serialize.h>
+#include <span.h>
+#include <sync.h>
 
 struct FlatFilePos
 {
@@ -87,4 +91,72 @@ public:
     bool Flush(const FlatFilePos& pos, bool finalize = false);
 };
 
+/** A read-only memory mapping of a whole flat file */
+class MappedFlatFile
+{
+private:
+    const uint8_t* m_data;
+    const size_t m_size;
+
+public:
+    MappedFlatFile(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+    ~MappedFlatFile();
+
+    MappedFlatFile(const MappedFlatFile&) = delete;
+    MappedFlatFile& operator=(const MappedFlatFile&) = delete;
+
+    /** The `len` bytes at `pos`, which must be within the mapping. */
+    Span<const uint8_t> Data(unsigned int pos, size_t len) const;
+    size_t Size() const { return m_size; }
+
+    /** Ask the OS to read the `len` bytes at `pos` (or up to the end of the mapping) ahead. */
+    void WillNeed(unsigned int pos, size_t len) const;
+};
+
+/**
+ * Memory maps the files of a FlatFileSeq for reading, keeping up to a given
+ * number of the most recently used mappings.
+ *
+ * Mappings are shared with writes made to the files through FlatFileSeq,
+ * and remapped when data beyond their end is requested. Files that are
+ * truncated or deleted must be so through Flush() and Delete(), which keep
+ * Map() from caching a mapping from before. Mapping is not supported on
+ * Windows, where Map() always returns null.
+ *
+ * Unlike a read, an access to a mapping cannot fail: a disk I/O error, or a
+ * file truncated behind our back, raises SIGBUS and terminates the process.
+ */
+class FlatFileMapCache
+{
+private:
+    mutable Mutex m_mutex;
+    size_t m_max_files GUARDED_BY(m_mutex);
+    //! Mappings by file name, most recently used first
+    std::list<std::pair<fs::path, std::shared_ptr<const MappedFlatFile>>> m_files GUARDED_BY(m_mutex);
+
+    void RemoveFile(const fs::path& path) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+public:
+    explicit FlatFileMapCache(size_t max_files) : m_max_files(max_files) {}
+
+    /**
+     * Map the file of `seq` at `pos`, which must hold at least `len` bytes
+     * from there. Returns null if the file cannot be mapped or is too short,
+     * or no files are to be mapped.
+     */
+    std::shared_ptr<const MappedFlatFile> Map(const FlatFileSeq& seq, const FlatFilePos& pos, size_t len);
+
+    /**
+     * Flush the file of `seq` at `pos` like FlatFileSeq::Flush(). A file that
+     * is finalized is truncated, so its mapping is dropped first.
+     */
+    bool Flush(FlatFileSeq seq, const FlatFilePos& pos, bool finalize = false);
+
+    /** Drop the mapping of the file of `seq` at `pos`, if any, and delete the file. */
+    void Delete(const FlatFileSeq& seq, const FlatFilePos& pos);
+
+    /** Set the number of mappings to keep, dropping the least recently used ones. */
+    void SetMaxFiles(size_t max_files);
+};
+
 #endif // BITCOIN_FLATFILE_H
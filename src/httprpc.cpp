@@ -7,6 +7,7 @@
 #include <chainparams.h>
 #include <crypto/hmac_sha256.h>
 #include <httpserver.h>
+#include <rpc/jsonstream.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <util/strencodings.h>
@@ -204,10 +205,41 @@ static bool HTTPReq_JSONRPC(const util::Ref& context, HTTPRequest* req)
                 req->WriteReply(HTTP_FORBIDDEN);
                 return false;
             }
-            UniValue result = tableRPC.execute(jreq);
+
+            // Large results are sent as a chunked reply while they are being
+            // written. Until the first chunk is flushed, errors are still
+            // reported normally. After that, the connection is closed before
+            // the reply is complete, so that the client does not take the
+            // truncated result as valid.
+            JSONStreamWriter stream([req](const std::string& chunk) {
+                if (!req->IsChunkedReplyStarted()) {
+                    req->WriteHeader("Content-Type", "application/json");
+                    req->StartChunkedReply(HTTP_OK);
+                    req->WriteReplyChunk("{\"result\":");
+                }
+                req->WriteReplyChunk(chunk);
+            });
+            jreq.stream = &stream;
+            const std::string reply_end = ",\"error\":null,\"id\":" + jreq.id.write() + "}\n";
+            try {
+                UniValue result = tableRPC.execute(jreq);
+                // Handlers that did not stream their result return it instead
+                if (stream.Empty()) stream.Value(result);
+            } catch (...) {
+                if (!stream.Flushed()) throw;
+                LogPrintf("RPC method %s failed after part of its result was sent, closing the connection\n", jreq.strMethod);
+                req->AbortChunkedReply();
+                return false;
+            }
+            if (stream.Flushed()) {
+                stream.Flush();
+                req->WriteReplyChunk(reply_end);
+                req->EndChunkedReply();
+                return true;
+            }
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            strReply = "{\"result\":" + stream.TakeBuffer() + reply_end;
 
         // array of requests
         } else if (valRequest.isArray()) {
@@ -284,6 +316,49 @@ static bool InitRPCAuthentication()
     return true;
 }
 
+/** RPC methods that can keep a worker busy for a long time */
+static const std::set<std::string> EXPENSIVE_RPC_METHODS{
+    "dumptxoutset",
+    "dumpwallet",
+    "getblock",
+    "getblockstats",
+    "getchaintxstats",
+    "getrawmempool",
+    "gettxoutsetinfo",
+    "importdescriptors",
+    "importmulti",
+    "importwallet",
+    "listsinceblock",
+    "listtransactions",
+    "listunspent",
+    "rescanblockchain",
+    "savemempool",
+    "scantxoutset",
+    "verifychain",
+};
+
+/** Classify a JSON-RPC request by the methods it calls. A batch is expensive
+ * if any of its calls is. Requests that do not parse are left to the handler
+ * to reject.
+ */
+static bool IsExpensiveJSONRPC(const HTTPRequest* req)
+{
+    UniValue request;
+    if (!request.read(req->PeekBody())) return false;
+    const auto is_expensive_call = [](const UniValue& call) {
+        if (!call.isObject()) return false;
+        const UniValue& method = find_value(call, "method");
+        return method.isStr() && EXPENSIVE_RPC_METHODS.count(method.get_str()) > 0;
+    };
+    if (request.isArray()) {
+        for (const UniValue& call : request.getValues()) {
+            if (is_expensive_call(call)) return true;
+        }
+        return false;
+    }
+    return is_expensive_call(request);
+}
+
 bool StartHTTPRPC(const util::Ref& context)
 {
     LogPrint(BCLog::RPC, "Starting HTTP RPC server\n");
@@ -291,9 +366,10 @@ bool StartHTTPRPC(const util::Ref& context)
         return false;
 
     auto handle_rpc = [&context](HTTPRequest* req, const std::string&) { return HTTPReq_JSONRPC(context, req); };
-    RegisterHTTPHandler("/", true, handle_rpc);
+    auto is_expensive = [](const HTTPRequest* req, const std::string&) { return IsExpensiveJSONRPC(req); };
+    RegisterHTTPHandler("/", true, handle_rpc, is_expensive);
     if (g_wallet_init_interface.HasWalletSupport()) {
-        RegisterHTTPHandler("/wallet/", false, handle_rpc);
+        RegisterHTTPHandler("/wallet/", false, handle_rpc, is_expensive);
     }
     struct event_base* eventBase = EventBase();
     assert(eventBase);
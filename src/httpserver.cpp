@@ -16,7 +16,10 @@
 #include <util/threadnames.h>
 #include <util/translation.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <deque>
+#include <map>
 #include <memory>
 #include <stdio.h>
 #include <stdlib.h>
@@ -43,28 +46,33 @@
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
 
+/** Maximum number of bytes of a chunked reply waiting to be sent to the client
+ * before WriteReplyChunk blocks */
+static const size_t MAX_CHUNKED_REPLY_BUFFER = 1024 * 1024;
+
 /** HTTP request work item */
 class HTTPWorkItem final : public HTTPClosure
 {
 public:
-    HTTPWorkItem(std::unique_ptr<HTTPRequest> _req, const std::string &_path, const HTTPRequestHandler& _func):
-        req(std::move(_req)), path(_path), func(_func)
-    {
-    }
-    void operator()() override
+    HTTPWorkItem(std::unique_ptr<HTTPRequest> _req, const std::string &_path, const HTTPRequestHandler& _func, const HTTPRequestClassifier& _is_expensive = nullptr):
+        req(std::move(_req)), path(_path), func(_func), is_expensive(_is_expensive)
     {
-        func(req.get(), path);
     }
+    void operator()() override;
 
     std::unique_ptr<HTTPRequest> req;
 
 private:
     std::string path;
     HTTPRequestHandler func;
+    //! If set, requests it classifies as expensive are moved to the expensive work queue
+    HTTPRequestClassifier is_expensive;
 };
 
 /** Simple work queue for distributing work over multiple threads.
- * Work items are simply callable objects.
+ * Work items are simply callable objects. Items are queued per client and
+ * clients are served round-robin, so that one client sending many requests
+ * cannot starve the others.
  */
 template <typename WorkItem>
 class WorkQueue
@@ -73,12 +81,16 @@ private:
     /** Mutex protects entire object */
     Mutex cs;
     std::condition_variable cond;
-    std::deque<std::unique_ptr<WorkItem>> queue;
+    std::map<std::string, std::deque<std::unique_ptr<WorkItem>>> queues;
+    /** Clients with queued items, in the order they will be served */
+    std::deque<std::string> clients;
+    size_t depth;
     bool running;
     size_t maxDepth;
 
 public:
-    explicit WorkQueue(size_t _maxDepth) : running(true),
+    explicit WorkQueue(size_t _maxDepth) : depth(0),
+                                 running(true),
                                  maxDepth(_maxDepth)
     {
     }
@@ -88,13 +100,18 @@ public:
     {
     }
     /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    bool Enqueue(WorkItem* item, const std::string& client)
     {
         LOCK(cs);
-        if (queue.size() >= maxDepth) {
+        if (depth >= maxDepth) {
             return false;
         }
+        auto& queue = queues[client];
+        if (queue.empty()) {
+            clients.push_back(client);
+        }
         queue.emplace_back(std::unique_ptr<WorkItem>(item));
+        ++depth;
         cond.notify_one();
         return true;
     }
@@ -105,12 +122,21 @@ public:
             std::unique_ptr<WorkItem> i;
             {
                 WAIT_LOCK(cs, lock);
-                while (running && queue.empty())
+                while (running && depth == 0)
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = std::move(queue.front());
-                queue.pop_front();
+                const std::string client = std::move(clients.front());
+                clients.pop_front();
+                auto it = queues.find(client);
+                i = std::move(it->second.front());
+                it->second.pop_front();
+                --depth;
+                if (it->second.empty()) {
+                    queues.erase(it);
+                } else {
+                    clients.push_back(client);
+                }
             }
             (*i)();
         }
@@ -126,29 +152,58 @@ public:
 
 struct HTTPPathHandler
 {
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, HTTPRequestClassifier _is_expensive):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), is_expensive(_is_expensive)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPRequestClassifier is_expensive;
 };
 
 /** HTTP module state */
 
-//! libevent event loop
-static struct event_base* eventBase = nullptr;
-//! HTTP server
-static struct evhttp* eventHTTP = nullptr;
+//! libevent event loops, one per event thread
+static std::vector<struct event_base*> eventBases;
+//! HTTP servers, one per event loop
+static std::vector<struct evhttp*> eventHTTPs;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
 static WorkQueue<HTTPClosure>* workQueue = nullptr;
+//! Work queue for expensive requests, if they are handled separately
+static WorkQueue<HTTPClosure>* workQueueExpensive = nullptr;
 //! Handlers for (sub)paths
 static std::vector<HTTPPathHandler> pathHandlers;
-//! Bound listening sockets
-static std::vector<evhttp_bound_socket *> boundSockets;
+//! Bound listening sockets, and the HTTP server accepting on each
+static std::vector<std::pair<struct evhttp*, evhttp_bound_socket *>> boundSockets;
+
+/** Queue a request, or reject it if the queue is full */
+static void EnqueueHTTPWorkItem(WorkQueue<HTTPClosure>* queue, std::unique_ptr<HTTPWorkItem> item)
+{
+    // Key by address and port, so that clients behind the same address
+    // (e.g. all local clients) are still served fairly
+    const std::string client = item->req->GetPeer().ToString();
+    assert(queue);
+    if (queue->Enqueue(item.get(), client))
+        item.release(); /* if true, queue took ownership */
+    else {
+        LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+        item->req->WriteReply(HTTP_INTERNAL_SERVER_ERROR, "Work queue depth exceeded");
+    }
+}
+
+void HTTPWorkItem::operator()()
+{
+    // Requests are classified on a worker thread rather than the event loop,
+    // so that the classifier can parse the request
+    if (is_expensive && is_expensive(req.get(), path)) {
+        EnqueueHTTPWorkItem(workQueueExpensive, std::unique_ptr<HTTPWorkItem>(new HTTPWorkItem(std::move(req), path, func)));
+        return;
+    }
+    func(req.get(), path);
+}
 
 /** Check if a network address is allowed to access the HTTP server */
 static bool ClientAllowed(const CNetAddr& netaddr)
@@ -263,14 +318,7 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
-        std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
-        assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
-            item.release(); /* if true, queue took ownership */
-        else {
-            LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
-            item->req->WriteReply(HTTP_INTERNAL_SERVER_ERROR, "Work queue depth exceeded");
-        }
+        EnqueueHTTPWorkItem(workQueue, std::unique_ptr<HTTPWorkItem>(new HTTPWorkItem(std::move(hreq), path, i->handler, workQueueExpensive ? i->is_expensive : HTTPRequestClassifier())));
     } else {
         hreq->WriteReply(HTTP_NOT_FOUND);
     }
@@ -284,9 +332,9 @@ static void http_reject_request_cb(struct evhttp_request* req, void*)
 }
 
 /** Event dispatcher thread */
-static bool ThreadHTTP(struct event_base* base)
+static bool ThreadHTTP(struct event_base* base, int thread_num)
 {
-    util::ThreadRename("http");
+    util::ThreadRename(thread_num == 0 ? "http" : strprintf("http.%i", thread_num));
     LogPrint(BCLog::HTTP, "Entering http event loop\n");
     event_base_dispatch(base);
     // Event loop will be interrupted by InterruptHTTPServer()
@@ -328,7 +376,7 @@ static bool HTTPBindAddresses(struct evhttp* http)
             if (i->first.empty() || (LookupHost(i->first, addr, false) && addr.IsBindAny())) {
                 LogPrintf("WARNING: the RPC server is not safe to expose to untrusted networks such as the public internet\n");
             }
-            boundSockets.push_back(bind_handle);
+            boundSockets.emplace_back(http, bind_handle);
         } else {
             LogPrintf("Binding RPC on address %s port %i failed.\n", i->first, i->second);
         }
@@ -336,6 +384,30 @@ static bool HTTPBindAddresses(struct evhttp* http)
     return !boundSockets.empty();
 }
 
+/** Accept connections on the already bound sockets in another HTTP server, so
+ * that its event loop thread shares the incoming connections. */
+static bool HTTPShareBoundSockets(struct evhttp* http)
+{
+#ifdef WIN32
+    return false;
+#else
+    const size_t num_sockets = boundSockets.size();
+    for (size_t i = 0; i < num_sockets; ++i) {
+        if (boundSockets[i].first != eventHTTPs.front()) continue;
+        // Each listener closes its socket when freed, so give it its own descriptor
+        evutil_socket_t fd = dup(evhttp_bound_socket_get_fd(boundSockets[i].second));
+        if (fd < 0) return false;
+        evhttp_bound_socket* handle = evhttp_accept_socket_with_handle(http, fd);
+        if (!handle) {
+            close(fd);
+            return false;
+        }
+        boundSockets.emplace_back(http, handle);
+    }
+    return true;
+#endif
+}
+
 /** Simple wrapper to set thread name and run work queue */
 static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, int worker_num)
 {
@@ -376,24 +448,41 @@ bool InitHTTPServer()
     evthread_use_pthreads();
 #endif
 
-    raii_event_base base_ctr = obtain_event_base();
+    int event_threads = std::max((long)gArgs.GetArg("-rpceventthreads", DEFAULT_HTTP_EVENT_THREADS), 1L);
+#ifdef WIN32
+    // Listening sockets can not be shared between event loops on Windows
+    event_threads = 1;
+#endif
 
-    /* Create a new evhttp object to handle requests. */
-    raii_evhttp http_ctr = obtain_evhttp(base_ctr.get());
-    struct evhttp* http = http_ctr.get();
-    if (!http) {
-        LogPrintf("couldn't create evhttp. Exiting.\n");
-        return false;
-    }
+    for (int i = 0; i < event_threads; ++i) {
+        raii_event_base base_ctr = obtain_event_base();
 
-    evhttp_set_timeout(http, gArgs.GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
-    evhttp_set_max_headers_size(http, MAX_HEADERS_SIZE);
-    evhttp_set_max_body_size(http, MAX_SIZE);
-    evhttp_set_gencb(http, http_request_cb, nullptr);
+        /* Create a new evhttp object to handle requests. */
+        raii_evhttp http_ctr = obtain_evhttp(base_ctr.get());
+        struct evhttp* http = http_ctr.get();
+        if (!http) {
+            LogPrintf("couldn't create evhttp. Exiting.\n");
+            return false;
+        }
 
-    if (!HTTPBindAddresses(http)) {
-        LogPrintf("Unable to bind any endpoint for RPC server\n");
-        return false;
+        evhttp_set_timeout(http, gArgs.GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
+        evhttp_set_max_headers_size(http, MAX_HEADERS_SIZE);
+        evhttp_set_max_body_size(http, MAX_SIZE);
+        evhttp_set_gencb(http, http_request_cb, nullptr);
+
+        if (i == 0) {
+            if (!HTTPBindAddresses(http)) {
+                LogPrintf("Unable to bind any endpoint for RPC server\n");
+                return false;
+            }
+        } else if (!HTTPShareBoundSockets(http)) {
+            LogPrintf("Unable to share RPC server sockets with event thread %d\n", i);
+            return false;
+        }
+
+        // transfer ownership to eventBases/eventHTTPs via .release()
+        eventBases.push_back(base_ctr.release());
+        eventHTTPs.push_back(http_ctr.release());
     }
 
     LogPrint(BCLog::HTTP, "Initialized HTTP server\n");
@@ -401,9 +490,9 @@ bool InitHTTPServer()
     LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
 
     workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
-    // transfer ownership to eventBase/HTTP via .release()
-    eventBase = base_ctr.release();
-    eventHTTP = http_ctr.release();
+    if (gArgs.GetArg("-rpcexpensivethreads", DEFAULT_HTTP_EXPENSIVE_THREADS) > 0) {
+        workQueueExpensive = new WorkQueue<HTTPClosure>(workQueueDepth);
+    }
     return true;
 }
 
@@ -421,30 +510,41 @@ bool UpdateHTTPServerLogging(bool enable) {
 #endif
 }
 
-static std::thread g_thread_http;
+static std::vector<std::thread> g_thread_http;
 static std::vector<std::thread> g_thread_http_workers;
 
 void StartHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Starting HTTP server\n");
     int rpcThreads = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
-    g_thread_http = std::thread(ThreadHTTP, eventBase);
+    LogPrintf("HTTP: starting %d event threads and %d worker threads\n", eventBases.size(), rpcThreads);
+    for (size_t i = 0; i < eventBases.size(); i++) {
+        g_thread_http.emplace_back(ThreadHTTP, eventBases[i], i);
+    }
 
     for (int i = 0; i < rpcThreads; i++) {
         g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueue, i);
     }
+    if (workQueueExpensive) {
+        int expensiveThreads = gArgs.GetArg("-rpcexpensivethreads", DEFAULT_HTTP_EXPENSIVE_THREADS);
+        LogPrintf("HTTP: starting %d worker threads for expensive requests\n", expensiveThreads);
+        for (int i = 0; i < expensiveThreads; i++) {
+            g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueueExpensive, rpcThreads + i);
+        }
+    }
 }
 
 void InterruptHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Interrupting HTTP server\n");
-    if (eventHTTP) {
+    for (struct evhttp* http : eventHTTPs) {
         // Reject requests on current connections
-        evhttp_set_gencb(eventHTTP, http_reject_request_cb, nullptr);
+        evhttp_set_gencb(http, http_reject_request_cb, nullptr);
     }
     if (workQueue)
         workQueue->Interrupt();
+    if (workQueueExpensive)
+        workQueueExpensive->Interrupt();
 }
 
 void StopHTTPServer()
@@ -458,31 +558,36 @@ void StopHTTPServer()
         g_thread_http_workers.clear();
         delete workQueue;
         workQueue = nullptr;
+        delete workQueueExpensive;
+        workQueueExpensive = nullptr;
     }
     // Unlisten sockets, these are what make the event loop running, which means
     // that after this and all connections are closed the event loop will quit.
-    for (evhttp_bound_socket *socket : boundSockets) {
-        evhttp_del_accept_socket(eventHTTP, socket);
+    for (const auto& socket : boundSockets) {
+        evhttp_del_accept_socket(socket.first, socket.second);
     }
     boundSockets.clear();
-    if (eventBase) {
-        LogPrint(BCLog::HTTP, "Waiting for HTTP event thread to exit\n");
-        if (g_thread_http.joinable()) g_thread_http.join();
+    if (!eventBases.empty()) {
+        LogPrint(BCLog::HTTP, "Waiting for HTTP event threads to exit\n");
+        for (auto& thread : g_thread_http) {
+            if (thread.joinable()) thread.join();
+        }
+        g_thread_http.clear();
     }
-    if (eventHTTP) {
-        evhttp_free(eventHTTP);
-        eventHTTP = nullptr;
+    for (struct evhttp* http : eventHTTPs) {
+        evhttp_free(http);
     }
-    if (eventBase) {
-        event_base_free(eventBase);
-        eventBase = nullptr;
+    eventHTTPs.clear();
+    for (struct event_base* base : eventBases) {
+        event_base_free(base);
     }
+    eventBases.clear();
     LogPrint(BCLog::HTTP, "Stopped HTTP server\n");
 }
 
 struct event_base* EventBase()
 {
-    return eventBase;
+    return eventBases.empty() ? nullptr : eventBases.front();
 }
 
 static void httpevent_callback_fn(evutil_socket_t, short, void* data)
@@ -511,13 +616,20 @@ void HTTPEvent::trigger(struct timeval* tv)
     else
         evtimer_add(ev, tv); // trigger after timeval passed
 }
-HTTPRequest::HTTPRequest(struct evhttp_request* _req, bool _replySent) : req(_req), replySent(_replySent)
+HTTPRequest::HTTPRequest(struct evhttp_request* _req, bool _replySent) : req(_req), base(EventBase()), replySent(_replySent)
 {
+    evhttp_connection* conn = req ? evhttp_request_get_connection(req) : nullptr;
+    if (conn) {
+        base = evhttp_connection_get_base(conn);
+    }
 }
 
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (chunkedReplyStarted && !replySent) {
+        LogPrintf("%s: Unfinished chunked reply\n", __func__);
+        AbortChunkedReply();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL_SERVER_ERROR, "Unhandled request");
@@ -556,6 +668,17 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+std::string HTTPRequest::PeekBody() const
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    std::string rv(evbuffer_get_length(buf), '\0');
+    const ev_ssize_t copied = evbuffer_copyout(buf, &rv[0], rv.size());
+    rv.resize(copied > 0 ? copied : 0);
+    return rv;
+}
+
 void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
 {
     struct evkeyvalq* headers = evhttp_request_get_output_headers(req);
@@ -568,9 +691,24 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
  * Replies must be sent in the main loop in the main http thread,
  * this cannot be done from worker threads.
  */
+/** Re-enable reading from the socket. This is the second part of the libevent
+ * workaround in http_request_cb. */
+static void ReenableReading(struct evhttp_request* req)
+{
+    if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
 {
-    assert(!replySent && req);
+    assert(!replySent && !chunkedReplyStarted && req);
     if (ShutdownRequested()) {
         WriteHeader("Connection", "close");
     }
@@ -579,18 +717,142 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     assert(evb);
     evbuffer_add(evb, strReply.data(), strReply.size());
     auto req_copy = req;
-    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
+    HTTPEvent* ev = new HTTPEvent(base, true, [req_copy, nStatus]{
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-        // Re-enable reading from the socket. This is the second part of the libevent
-        // workaround above.
-        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
+        ReenableReading(req_copy);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
+/** The part of a chunked reply that was not written to the client's socket
+ * yet. Shared by the worker writing the reply and the event loop sending it. */
+struct HTTPChunkedReplyState
+{
+    Mutex mutex;
+    std::condition_variable cond;
+    //! Bytes of chunks not yet handed to the connection by the event loop
+    size_t pending GUARDED_BY(mutex){0};
+    //! Size of the connection's output buffer when the event loop last looked
+    size_t buffered GUARDED_BY(mutex){0};
+};
+
+/** Return the number of bytes waiting in the output buffer of a request's
+ * connection. Must be called on the event loop that owns the connection. */
+static size_t GetOutputBufferSize(struct evhttp_request* req)
+{
+    evhttp_connection* conn = evhttp_request_get_connection(req);
+    bufferevent* bev = conn ? evhttp_connection_get_bufferevent(conn) : nullptr;
+    return bev ? evbuffer_get_length(bufferevent_get_output(bev)) : 0;
+}
+
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && !chunkedReplyStarted && req);
+    if (ShutdownRequested()) {
+        WriteHeader("Connection", "close");
+    }
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(base, true, [req_copy, nStatus]{
+        evhttp_send_reply_start(req_copy, nStatus, nullptr);
+    });
+    ev->trigger(nullptr);
+    chunkedReplyStarted = true;
+    chunkedReply = std::make_shared<HTTPChunkedReplyState>();
+}
+
+bool HTTPRequest::WaitForChunkedReplyBuffer()
+{
+    if (chunkedReplyFailed) return false;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(gArgs.GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
+    auto state = chunkedReply;
+    WAIT_LOCK(state->mutex, lock);
+    while (state->pending + state->buffered > MAX_CHUNKED_REPLY_BUFFER) {
+        if (ShutdownRequested() || std::chrono::steady_clock::now() >= deadline) {
+            LogPrint(BCLog::HTTP, "Client stopped reading a chunked reply, dropping the rest of it\n");
+            chunkedReplyFailed = true;
+            return false;
+        }
+        // libevent does not tell us when the output buffer drains, so ask the
+        // event loop to look at it again once it has handled all chunks
+        if (state->pending == 0) {
+            auto req_copy = req;
+            HTTPEvent* ev = new HTTPEvent(base, true, [req_copy, state]{
+                {
+                    LOCK(state->mutex);
+                    state->buffered = GetOutputBufferSize(req_copy);
                 }
-            }
+                state->cond.notify_all();
+            });
+            ev->trigger(nullptr);
+        }
+        state->cond.wait_for(lock, std::chrono::milliseconds(50));
+    }
+    return true;
+}
+
+void HTTPRequest::WriteReplyChunk(const std::string& chunk)
+{
+    assert(!replySent && chunkedReplyStarted && req);
+    if (chunk.empty()) return;
+    if (!WaitForChunkedReplyBuffer()) return;
+    // Events on a base are handled in the order they were triggered, so the
+    // chunks are sent in order
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, chunk.data(), chunk.size());
+    auto req_copy = req;
+    auto state = chunkedReply;
+    const size_t size = chunk.size();
+    {
+        LOCK(state->mutex);
+        state->pending += size;
+    }
+    HTTPEvent* ev = new HTTPEvent(base, true, [req_copy, evb, state, size]{
+        evhttp_send_reply_chunk(req_copy, evb);
+        evbuffer_free(evb);
+        {
+            LOCK(state->mutex);
+            state->pending -= size;
+            state->buffered = GetOutputBufferSize(req_copy);
+        }
+        state->cond.notify_all();
+    });
+    ev->trigger(nullptr);
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(!replySent && chunkedReplyStarted && req);
+    if (chunkedReplyFailed) {
+        // Some chunks were dropped, do not let the client take the rest as complete
+        AbortChunkedReply();
+        return;
+    }
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(base, true, [req_copy]{
+        evhttp_send_reply_end(req_copy);
+        ReenableReading(req_copy);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
+void HTTPRequest::AbortChunkedReply()
+{
+    assert(!replySent && chunkedReplyStarted && req);
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(base, true, [req_copy]{
+        // Freeing the connection also frees the request. Without the final
+        // empty chunk the client knows the body is truncated. A request whose
+        // connection is already gone has to be freed on its own.
+        evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+        if (conn) {
+            evhttp_connection_free(conn);
+        } else {
+            evhttp_request_free(req_copy);
         }
     });
     ev->trigger(nullptr);
@@ -638,10 +900,10 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod() const
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPRequestClassifier &is_expensive)
 {
     LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, is_expensive));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
@@ -7,8 +7,11 @@
 
 #include <string>
 #include <functional>
+#include <memory>
 
 static const int DEFAULT_HTTP_THREADS=4;
+static const int DEFAULT_HTTP_EXPENSIVE_THREADS=2;
+static const int DEFAULT_HTTP_EVENT_THREADS=1;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
@@ -37,19 +40,27 @@ bool UpdateHTTPServerLogging(bool enable);
 
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Returns whether a request is expensive to serve. Expensive requests are
+ * handled by their own worker threads (-rpcexpensivethreads), so that they
+ * cannot starve cheap ones. Called on a worker thread before the handler, so
+ * it must not consume the request body.
+ */
+typedef std::function<bool(const HTTPRequest* req, const std::string &)> HTTPRequestClassifier;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
  * be invoked.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPRequestClassifier &is_expensive = nullptr);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
-/** Return evhttp event base. This can be used by submodules to
- * queue timers or custom events.
+/** Return the event base of the first HTTP event thread. This can be used by
+ * submodules to queue timers or custom events.
  */
 struct event_base* EventBase();
 
+struct HTTPChunkedReplyState;
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
@@ -57,7 +68,15 @@ class HTTPRequest
 {
 private:
     struct evhttp_request* req;
+    //! Event base of the thread that owns the request's connection
+    struct event_base* base;
     bool replySent;
+    bool chunkedReplyStarted{false};
+    //! Set when the client stopped reading a chunked reply, to drop the remaining chunks
+    bool chunkedReplyFailed{false};
+    std::shared_ptr<HTTPChunkedReplyState> chunkedReply;
+
+    bool WaitForChunkedReplyBuffer();
 
 public:
     explicit HTTPRequest(struct evhttp_request* req, bool replySent = false);
@@ -97,6 +116,11 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Return the request body without consuming it.
+     */
+    std::string PeekBody() const;
+
     /**
      * Write output header.
      *
@@ -113,6 +137,33 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a chunked HTTP reply, so that a large body can be sent while it is
+     * being produced. Follow with any number of WriteReplyChunk calls and one
+     * EndChunkedReply call instead of calling WriteReply.
+     *
+     * @note Write headers before calling this.
+     */
+    void StartChunkedReply(int nStatus);
+    bool IsChunkedReplyStarted() const { return chunkedReplyStarted; }
+    /**
+     * Send a chunk of a chunked HTTP reply. Blocks while too much of the reply
+     * is waiting to be sent to the client, so that a client reading slowly does
+     * not make the whole reply pile up in memory.
+     */
+    void WriteReplyChunk(const std::string& chunk);
+    /**
+     * Finish a chunked HTTP reply. As this will give the request back to the
+     * main thread, do not call any other HTTPRequest methods after calling this.
+     */
+    void EndChunkedReply();
+    /**
+     * Close the connection without finishing a chunked reply, so that the
+     * client sees the reply is incomplete. Use this when the rest of the body
+     * cannot be produced. Do not call any other HTTPRequest methods after this.
+     */
+    void AbortChunkedReply();
 };
 
 /** Event handler closure.
@@ -8,14 +8,29 @@
 #include <shutdown.h>
 #include <tinyformat.h>
 #include <util/system.h>
+#include <util/threadnames.h>
 #include <util/translation.h>
 #include <validation.h>
 #include <warnings.h>
 
+#include <condition_variable>
+#include <deque>
+#include <map>
+
 constexpr char DB_BEST_BLOCK = 'B';
 
 constexpr int64_t SYNC_LOG_INTERVAL = 30; // seconds
 constexpr int64_t SYNC_LOCATOR_WRITE_INTERVAL = 30; // seconds
+//! Blocks read and processed ahead of a syncing index
+constexpr size_t SYNC_READ_AHEAD = 64;
+//! Size of the index entries written at once while syncing
+constexpr size_t SYNC_BATCH_SIZE = 16 << 20;
+
+static std::atomic<int> g_index_sync_threads{DEFAULT_INDEX_SYNC_THREADS};
+
+static Mutex g_sync_blocks_mutex;
+//! Blocks held by syncing indexes, so that indexes syncing together read each block once
+static std::map<uint256, std::weak_ptr<const CBlock>> g_sync_blocks GUARDED_BY(g_sync_blocks_mutex);
 
 template <typename... Args>
 static void FatalError(const char* fmt, const Args&... args)
@@ -27,8 +42,157 @@ static void FatalError(const char* fmt, const Args&... args)
     StartShutdown();
 }
 
-BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate) :
-    CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate)
+void SetIndexSyncThreads(int num_threads)
+{
+    g_index_sync_threads = std::max(1, num_threads);
+}
+
+static std::shared_ptr<const CBlock> ReadSyncBlock(const CBlockIndex* pindex, const Consensus::Params& consensus_params)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    {
+        LOCK(g_sync_blocks_mutex);
+        auto it = g_sync_blocks.find(hash);
+        if (it != g_sync_blocks.end()) {
+            if (std::shared_ptr<const CBlock> block = it->second.lock()) return block;
+        }
+    }
+
+    std::shared_ptr<CBlock> block = std::make_shared<CBlock>();
+    if (!ReadBlockFromDisk(*block, pindex, consensus_params, /* read_ahead */ true)) return nullptr;
+
+    LOCK(g_sync_blocks_mutex);
+    g_sync_blocks[hash] = block;
+    if (g_sync_blocks.size() > 4 * SYNC_READ_AHEAD) {
+        for (auto it = g_sync_blocks.begin(); it != g_sync_blocks.end();) {
+            it = it->second.expired() ? g_sync_blocks.erase(it) : std::next(it);
+        }
+    }
+    return block;
+}
+
+/**
+ * Reads the blocks ahead of a syncing index and computes their index data
+ * on a pool of threads, handing them back in the order they were queued.
+ */
+class BaseIndex::SyncPipeline
+{
+public:
+    SyncPipeline(const BaseIndex& index, const Consensus::Params& consensus_params, int num_threads)
+        : m_index(index), m_consensus_params(consensus_params)
+    {
+        for (int i = 0; i < num_threads; ++i) {
+            m_workers.emplace_back(&SyncPipeline::WorkerThread, this, i);
+        }
+    }
+
+    ~SyncPipeline()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_work_cv.notify_all();
+        for (std::thread& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    size_t Size() const
+    {
+        LOCK(m_mutex);
+        return m_jobs.size();
+    }
+
+    void Push(const CBlockIndex* pindex)
+    {
+        {
+            LOCK(m_mutex);
+            m_jobs.push_back(std::make_shared<Job>(pindex));
+        }
+        m_work_cv.notify_one();
+    }
+
+    /** Wait for the first block queued, and take it. `block` is null if it could not be read. */
+    const CBlockIndex* Pop(std::shared_ptr<const CBlock>& block, std::unique_ptr<BlockData>& data)
+    {
+        std::shared_ptr<Job> job;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            assert(!m_jobs.empty());
+            m_done_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_jobs.front()->done; });
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        block = std::move(job->block);
+        data = std::move(job->data);
+        return job->pindex;
+    }
+
+private:
+    struct Job {
+        explicit Job(const CBlockIndex* pindex_in) : pindex(pindex_in) {}
+
+        const CBlockIndex* const pindex;
+        //! Guarded by m_mutex
+        bool started{false};
+        bool done{false};
+        std::shared_ptr<const CBlock> block;
+        std::unique_ptr<BlockData> data;
+    };
+
+    void WorkerThread(int id)
+    {
+        util::ThreadRename(strprintf("idxsync.%i", id));
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_work_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                    if (m_stop) return true;
+                    for (const std::shared_ptr<Job>& queued : m_jobs) {
+                        if (!queued->started) {
+                            job = queued;
+                            return true;
+                        }
+                    }
+                    return false;
+                });
+                if (m_stop) return;
+                job->started = true;
+            }
+
+            job->block = ReadSyncBlock(job->pindex, m_consensus_params);
+            if (job->block) {
+                try {
+                    job->data = m_index.ComputeBlock(*job->block, job->pindex);
+                } catch (const std::exception& e) {
+                    // Leave failing to the WriteBlock() of the block
+                    LogPrintf("%s: Failed to process block %s for %s: %s\n", __func__,
+                              job->pindex->GetBlockHash().ToString(), m_index.GetName(), e.what());
+                }
+            }
+
+            LOCK(m_mutex);
+            job->done = true;
+            m_done_cv.notify_all();
+        }
+    }
+
+    const BaseIndex& m_index;
+    const Consensus::Params& m_consensus_params;
+
+    mutable Mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    //! Blocks queued, in chain order
+    std::deque<std::shared_ptr<Job>> m_jobs GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_workers;
+};
+
+BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate, const DBTuning& tuning) :
+    CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate, tuning)
 {}
 
 bool BaseIndex::DB::ReadBestBlock(CBlockLocator& locator) const
@@ -89,11 +253,25 @@ void BaseIndex::ThreadSync()
     const CBlockIndex* pindex = m_best_block_index.load();
     if (!m_synced) {
         auto& consensus_params = Params().GetConsensus();
+        SyncPipeline pipeline(*this, consensus_params, g_index_sync_threads);
+        // Last block queued in the pipeline, or pindex if there are none
+        const CBlockIndex* pindex_queued = pindex;
+        // Index entries of the blocks up to pindex not written yet
+        CDBBatch batch(GetDB());
+        const auto write_batch = [&, func = __func__] {
+            if (!GetDB().WriteBatch(batch)) {
+                FatalError("%s: Failed to write %s entries to the index database", func, GetName());
+                return false;
+            }
+            batch.Clear();
+            return true;
+        };
 
         int64_t last_log_time = 0;
         int64_t last_locator_write_time = 0;
         while (true) {
             if (m_interrupt) {
+                if (!write_batch()) return;
                 m_best_block_index = pindex;
                 // No need to handle errors in Commit. If it fails, the error will be already be
                 // logged. The best way to recover is to continue, as index cannot be corrupted by
@@ -104,22 +282,38 @@ void BaseIndex::ThreadSync()
 
             {
                 LOCK(cs_main);
-                const CBlockIndex* pindex_next = NextSyncBlock(pindex);
-                if (!pindex_next) {
-                    m_best_block_index = pindex;
-                    m_synced = true;
-                    // No need to handle errors in Commit. See rationale above.
-                    Commit();
-                    break;
+                // Queue the blocks following the last one queued, as long as they extend it
+                while (pipeline.Size() < SYNC_READ_AHEAD) {
+                    const CBlockIndex* pindex_next = NextSyncBlock(pindex_queued);
+                    if (!pindex_next || pindex_next->pprev != pindex_queued) break;
+                    pipeline.Push(pindex_next);
+                    pindex_queued = pindex_next;
                 }
-                if (pindex_next->pprev != pindex && !Rewind(pindex, pindex_next->pprev)) {
-                    FatalError("%s: Failed to rewind index %s to a previous chain tip",
-                               __func__, GetName());
-                    return;
+                if (pipeline.Size() == 0) {
+                    const CBlockIndex* pindex_next = NextSyncBlock(pindex);
+                    if (!write_batch()) return;
+                    m_best_block_index = pindex;
+                    if (!pindex_next) {
+                        m_synced = true;
+                        // No need to handle errors in Commit. See rationale above.
+                        Commit();
+                        break;
+                    }
+                    // The index is on a stale branch
+                    if (!Rewind(pindex, pindex_next->pprev)) {
+                        FatalError("%s: Failed to rewind index %s to a previous chain tip",
+                                   __func__, GetName());
+                        return;
+                    }
+                    pindex = pindex_queued = pindex_next->pprev;
+                    continue;
                 }
-                pindex = pindex_next;
             }
 
+            std::shared_ptr<const CBlock> block;
+            std::unique_ptr<BlockData> data;
+            pindex = pipeline.Pop(block, data);
+
             int64_t current_time = GetTime();
             if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
                 LogPrintf("Syncing %s with block chain from height %d\n",
@@ -127,24 +321,25 @@ void BaseIndex::ThreadSync()
                 last_log_time = current_time;
             }
 
-            if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
-                m_best_block_index = pindex;
-                last_locator_write_time = current_time;
-                // No need to handle errors in Commit. See rationale above.
-                Commit();
-            }
-
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
+            if (!block) {
                 FatalError("%s: Failed to read block %s from disk",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
             }
-            if (!WriteBlock(block, pindex)) {
+            if (!WriteBlock(*block, pindex, data.get(), batch)) {
                 FatalError("%s: Failed to write block %s to index database",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
             }
+            if (batch.SizeEstimate() > SYNC_BATCH_SIZE && !write_batch()) return;
+
+            if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
+                if (!write_batch()) return;
+                m_best_block_index = pindex;
+                last_locator_write_time = current_time;
+                // No need to handle errors in Commit. See rationale above.
+                Commit();
+            }
         }
     }
 
@@ -220,7 +415,9 @@ void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const
         }
     }
 
-    if (WriteBlock(*block, pindex)) {
+    std::unique_ptr<BlockData> data = ComputeBlock(*block, pindex);
+    CDBBatch batch(GetDB());
+    if (WriteBlock(*block, pindex, data.get(), batch) && GetDB().WriteBatch(batch)) {
         m_best_block_index = pindex;
     } else {
         FatalError("%s: Failed to write block %s to index",
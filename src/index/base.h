@@ -11,8 +11,18 @@
 #include <threadinterrupt.h>
 #include <validationinterface.h>
 
+#include <memory>
+
 class CBlockIndex;
 
+/** Default number of -indexthreads */
+static const int DEFAULT_INDEX_SYNC_THREADS = 4;
+/** Maximum number of -indexthreads */
+static const int MAX_INDEX_SYNC_THREADS = 16;
+
+/** Set the number of threads each index uses to read and process blocks while syncing. */
+void SetIndexSyncThreads(int num_threads);
+
 struct IndexSummary {
     std::string name;
     bool synced{false};
@@ -23,6 +33,10 @@ struct IndexSummary {
  * Base class for indices of blockchain data. This implements
  * CValidationInterface and ensures blocks are indexed sequentially according
  * to their position in the active chain.
+ *
+ * While catching up with the chain, blocks are read and their index data
+ * computed ahead of time on a pool of threads (see ComputeBlock()), and
+ * then written in chain order in large batches.
  */
 class BaseIndex : public CValidationInterface
 {
@@ -38,7 +52,8 @@ protected:
     {
     public:
         DB(const fs::path& path, size_t n_cache_size,
-           bool f_memory = false, bool f_wipe = false, bool f_obfuscate = false);
+           bool f_memory = false, bool f_wipe = false, bool f_obfuscate = false,
+           const DBTuning& tuning = {});
 
         /// Read block locator of the chain that the txindex is in sync with.
         bool ReadBestBlock(CBlockLocator& locator) const;
@@ -59,6 +74,8 @@ private:
     std::thread m_thread_sync;
     CThreadInterrupt m_interrupt;
 
+    class SyncPipeline;
+
     /// Sync the index with the block index starting from the current best block.
     /// Intended to be run in its own thread, m_thread_sync, and can be
     /// interrupted with m_interrupt. Once the index gets in sync, the m_synced
@@ -84,8 +101,20 @@ protected:
     /// Initialize internal state from the database and block index.
     virtual bool Init();
 
-    /// Write update index entries for a newly connected block.
-    virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) { return true; }
+    /// Index data of a block, computed by ComputeBlock().
+    struct BlockData {
+        virtual ~BlockData() = default;
+    };
+
+    /// Compute the index data of a block, which does not depend on the index
+    /// state. While syncing, this is called from several threads at once for
+    /// the blocks ahead of the index. May return null.
+    virtual std::unique_ptr<BlockData> ComputeBlock(const CBlock& block, const CBlockIndex* pindex) const { return nullptr; }
+
+    /// Write update index entries for a newly connected block to `batch`,
+    /// given the result of ComputeBlock() for it. The batch may be written
+    /// together with the ones of the following blocks.
+    virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex, const BlockData* data, CDBBatch& batch) { return true; }
 
     /// Virtual method called internally by Commit that can be overridden to atomically
     /// commit more index state.
@@ -93,7 +93,8 @@ struct DBHashKey {
 static std::map<BlockFilterType, BlockFilterIndex> g_filter_indexes;
 
 BlockFilterIndex::BlockFilterIndex(BlockFilterType filter_type,
-                                   size_t n_cache_size, bool f_memory, bool f_wipe)
+                                   size_t n_cache_size, bool f_memory, bool f_wipe,
+                                   const DBTuning& tuning)
     : m_filter_type(filter_type)
 {
     const std::string& filter_name = BlockFilterTypeName(filter_type);
@@ -103,7 +104,7 @@ BlockFilterIndex::BlockFilterIndex(BlockFilterType filter_type,
     fs::create_directories(path);
 
     m_name = filter_name + " block filter index";
-    m_db = MakeUnique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe);
+    m_db = MakeUnique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe, false, tuning);
     m_filter_fileseq = MakeUnique<FlatFileSeq>(std::move(path), "fltr", FLTR_FILE_CHUNK_SIZE);
 }
 
@@ -208,32 +209,48 @@ size_t BlockFilterIndex::WriteFilterToDisk(FlatFilePos& pos, const BlockFilter&
     return data_size;
 }
 
-bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+/** The filter of a block */
+struct BlockFilterIndex::BlockFilterData : public BaseIndex::BlockData {
+    BlockFilter filter;
+};
+
+std::unique_ptr<BaseIndex::BlockData> BlockFilterIndex::ComputeBlock(const CBlock& block, const CBlockIndex* pindex) const
 {
     CBlockUndo block_undo;
-    uint256 prev_header;
+    if (pindex->nHeight > 0 && !UndoReadFromDisk(block_undo, pindex)) {
+        return nullptr;
+    }
 
-    if (pindex->nHeight > 0) {
-        if (!UndoReadFromDisk(block_undo, pindex)) {
-            return false;
-        }
+    auto data = MakeUnique<BlockFilterData>();
+    data->filter = BlockFilter(m_filter_type, block, block_undo);
+    return data;
+}
 
-        std::pair<uint256, DBVal> read_out;
-        if (!m_db->Read(DBHeightKey(pindex->nHeight - 1), read_out)) {
-            return false;
-        }
+bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex, const BlockData* data, CDBBatch& batch)
+{
+    if (!data) return false;
+    const BlockFilter& filter = static_cast<const BlockFilterData*>(data)->filter;
 
-        uint256 expected_block_hash = pindex->pprev->GetBlockHash();
-        if (read_out.first != expected_block_hash) {
-            return error("%s: previous block header belongs to unexpected block %s; expected %s",
-                         __func__, read_out.first.ToString(), expected_block_hash.ToString());
+    uint256 prev_header;
+    if (pindex->nHeight > 0) {
+        const uint256& expected_block_hash = pindex->pprev->GetBlockHash();
+        if (m_last_header.first == expected_block_hash) {
+            prev_header = m_last_header.second;
+        } else {
+            std::pair<uint256, DBVal> read_out;
+            if (!m_db->Read(DBHeightKey(pindex->nHeight - 1), read_out)) {
+                return false;
+            }
+
+            if (read_out.first != expected_block_hash) {
+                return error("%s: previous block header belongs to unexpected block %s; expected %s",
+                             __func__, read_out.first.ToString(), expected_block_hash.ToString());
+            }
+
+            prev_header = read_out.second.header;
         }
-
-        prev_header = read_out.second.header;
     }
 
-    BlockFilter filter(m_filter_type, block, block_undo);
-
     size_t bytes_written = WriteFilterToDisk(m_next_filter_pos, filter);
     if (bytes_written == 0) return false;
 
@@ -243,9 +260,8 @@ bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex
     value.second.header = filter.ComputeHeader(prev_header);
     value.second.pos = m_next_filter_pos;
 
-    if (!m_db->Write(DBHeightKey(pindex->nHeight), value)) {
-        return false;
-    }
+    batch.Write(DBHeightKey(pindex->nHeight), value);
+    m_last_header = std::make_pair(value.first, value.second.header);
 
     m_next_filter_pos.nPos += bytes_written;
     return true;
@@ -462,12 +478,13 @@ void ForEachBlockFilterIndex(std::function<void (BlockFilterIndex&)> fn)
 }
 
 bool InitBlockFilterIndex(BlockFilterType filter_type,
-                          size_t n_cache_size, bool f_memory, bool f_wipe)
+                          size_t n_cache_size, bool f_memory, bool f_wipe,
+                          const DBTuning& tuning)
 {
     auto result = g_filter_indexes.emplace(std::piecewise_construct,
                                            std::forward_as_tuple(filter_type),
                                            std::forward_as_tuple(filter_type,
-                                                                 n_cache_size, f_memory, f_wipe));
+                                                                 n_cache_size, f_memory, f_wipe, tuning));
     return result.second;
 }
 
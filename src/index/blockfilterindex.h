@@ -35,6 +35,11 @@ private:
     FlatFilePos m_next_filter_pos;
     std::unique_ptr<FlatFileSeq> m_filter_fileseq;
 
+    /** Hash and filter header of the last block written, whose entry may not be in the database yet */
+    std::pair<uint256, uint256> m_last_header;
+
+    struct BlockFilterData;
+
     bool ReadFilterFromDisk(const FlatFilePos& pos, BlockFilter& filter) const;
     size_t WriteFilterToDisk(FlatFilePos& pos, const BlockFilter& filter);
 
@@ -47,7 +52,9 @@ protected:
 
     bool CommitInternal(CDBBatch& batch) override;
 
-    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+    std::unique_ptr<BlockData> ComputeBlock(const CBlock& block, const CBlockIndex* pindex) const override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex, const BlockData* data, CDBBatch& batch) override;
 
     bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
 
@@ -58,7 +65,8 @@ protected:
 public:
     /** Constructs the index, which becomes available to be queried. */
     explicit BlockFilterIndex(BlockFilterType filter_type,
-                              size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+                              size_t n_cache_size, bool f_memory = false, bool f_wipe = false,
+                              const DBTuning& tuning = {});
 
     BlockFilterType GetFilterType() const { return m_filter_type; }
 
@@ -91,7 +99,8 @@ void ForEachBlockFilterIndex(std::function<void (BlockFilterIndex&)> fn);
  * a new index is created and false if one has already been initialized.
  */
 bool InitBlockFilterIndex(BlockFilterType filter_type,
-                          size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+                          size_t n_cache_size, bool f_memory = false, bool f_wipe = false,
+                          const DBTuning& tuning = {});
 
 /**
  * Destroy the block filter index with the given type. Returns false if no such index exists. This
@@ -22,11 +22,15 @@ protected:
 private:
     const std::unique_ptr<DB> m_db;
 
+    struct BlockTxs;
+
 protected:
     /// Override base class init to migrate from old database.
     bool Init() override;
 
-    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+    std::unique_ptr<BlockData> ComputeBlock(const CBlock& block, const CBlockIndex* pindex) const override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex, const BlockData* data, CDBBatch& batch) override;
 
     BaseIndex::DB& GetDB() const override;
 
@@ -34,7 +38,7 @@ protected:
 
 public:
     /// Constructs the index, which becomes available to be queried.
-    explicit TxIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+    explicit TxIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false, const DBTuning& tuning = {});
 
     // Destructor is declared because this class contains a unique_ptr to an incomplete type.
     virtual ~TxIndex() override;
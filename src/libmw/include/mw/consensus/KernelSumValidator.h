@@ -41,6 +41,26 @@ public:
         );
     }
 
+    // Same as ValidateState, for callers that add up the utxo commitments,
+    // kernel excesses and supply changes as they read them, so that the
+    // entire state does not have to be held in memory.
+    //
+    // Throws a ValidationException if the utxo sum != kernel sum.
+    static void ValidateStateSums(
+        const Commitment& utxo_sum,
+        const Commitment& kernel_excess_sum,
+        const int64_t total_mweb_supply,
+        const BlindingFactor& total_offset)
+    {
+        ValidateSums(
+            {},
+            { utxo_sum },
+            { kernel_excess_sum },
+            total_offset,
+            total_mweb_supply
+        );
+    }
+
     static void ValidateForBlock(
         const TxBody& body,
         const BlindingFactor& total_offset,
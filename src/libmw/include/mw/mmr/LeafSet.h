@@ -92,4 +92,30 @@ public:
 private:
     ILeafSet::Ptr m_pBacked;
     std::unordered_map<uint64_t, uint8_t> m_modifiedBytes;
-};
\ No newline at end of file
+};
+
+/// <summary>
+/// A leafset held entirely in memory, e.g. one read from a UTXO snapshot.
+/// </summary>
+class MemLeafSet : public ILeafSet
+{
+public:
+    using Ptr = std::shared_ptr<MemLeafSet>;
+
+    MemLeafSet(const mmr::LeafIndex& nextLeafIdx, std::vector<uint8_t> bytes)
+        : ILeafSet(nextLeafIdx), m_bytes(std::move(bytes)) { }
+
+    uint8_t GetByte(const uint64_t byteIdx) const final;
+    void SetByte(const uint64_t byteIdx, const uint8_t value) final;
+
+    void ApplyUpdates(
+        const uint32_t file_index,
+        const mmr::LeafIndex& nextLeafIdx,
+        const std::unordered_map<uint64_t, uint8_t>& modifiedBytes
+    ) final;
+
+    const std::vector<uint8_t>& GetBytes() const noexcept { return m_bytes; }
+
+private:
+    std::vector<uint8_t> m_bytes;
+};
@@ -41,6 +41,17 @@ public:
         const uint16_t num_leaves
     );
 
+    /// <summary>
+    /// Recomputes the PMMR root from a segment's leaves, proof hashes, and lower peak.
+    /// The leafset is needed to determine which hashes the segment must contain.
+    /// </summary>
+    /// <returns>The PMMR root, or boost::none if the segment is malformed.</returns>
+    static boost::optional<mw::Hash> CalcRoot(
+        const Segment& segment,
+        const ILeafSet& leafset,
+        const LeafIndex& first_leaf_idx
+    );
+
 private:
     static std::set<Index> CalcHashIndices(
         const ILeafSet& leafset,
@@ -103,4 +103,34 @@ uint8_t LeafSet::GetByte(const uint64_t byteIdx) const
 void LeafSet::SetByte(const uint64_t byteIdx, const uint8_t value)
 {
     m_modifiedBytes[byteIdx + 8] = value;
-}
\ No newline at end of file
+}
+
+uint8_t MemLeafSet::GetByte(const uint64_t byteIdx) const
+{
+    return byteIdx < m_bytes.size() ? m_bytes[byteIdx] : 0;
+}
+
+void MemLeafSet::SetByte(const uint64_t byteIdx, const uint8_t value)
+{
+    if (byteIdx >= m_bytes.size()) {
+        m_bytes.resize(byteIdx + 1);
+    }
+
+    m_bytes[byteIdx] = value;
+}
+
+void MemLeafSet::ApplyUpdates(
+    const uint32_t file_index,
+    const mmr::LeafIndex& nextLeafIdx,
+    const std::unordered_map<uint64_t, uint8_t>& modifiedBytes)
+{
+    for (auto byte : modifiedBytes) {
+        SetByte(byte.first, byte.second);
+    }
+
+    for (size_t idx = nextLeafIdx.Get(); idx < m_nextLeafIdx.Get(); idx++) {
+        Remove(mmr::LeafIndex::At(idx));
+    }
+
+    m_nextLeafIdx = nextLeafIdx;
+}
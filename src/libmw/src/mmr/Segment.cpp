@@ -3,6 +3,9 @@
 #include <mw/mmr/MMR.h>
 #include <mw/mmr/MMRUtil.h>
 
+#include <functional>
+#include <map>
+
 using namespace mmr;
 
 Segment SegmentFactory::Assemble(const IMMR& mmr, const ILeafSet& leafset, const LeafIndex& first_leaf_idx, const uint16_t num_leaves)
@@ -50,6 +53,92 @@ Segment SegmentFactory::Assemble(const IMMR& mmr, const ILeafSet& leafset, const
 }
 
 
+boost::optional<mw::Hash> SegmentFactory::CalcRoot(const Segment& segment, const ILeafSet& leafset, const LeafIndex& first_leaf_idx)
+{
+    if (segment.leaves.empty() || segment.leaves.front().GetLeafIndex() != first_leaf_idx) {
+        return boost::none;
+    }
+
+    // The leaves must be exactly the unspent leaves from first_leaf_idx through the last leaf
+    const mmr::LeafIndex last_leaf_idx = segment.leaves.back().GetLeafIndex();
+    auto leaf_iter = segment.leaves.cbegin();
+    for (mmr::LeafIndex leaf_idx = first_leaf_idx; leaf_idx <= last_leaf_idx; ++leaf_idx) {
+        if (!leafset.Contains(leaf_idx)) {
+            continue;
+        }
+
+        if (leaf_iter == segment.leaves.cend() || leaf_iter->GetLeafIndex() != leaf_idx) {
+            return boost::none;
+        }
+
+        ++leaf_iter;
+    }
+
+    if (leaf_iter != segment.leaves.cend()) {
+        return boost::none;
+    }
+
+    std::vector<Index> peak_indices = MMRUtil::CalcPeakIndices(leafset.GetNumNodes());
+    std::set<Index> hash_indices = CalcHashIndices(leafset, peak_indices, first_leaf_idx, last_leaf_idx);
+    if (hash_indices.size() != segment.hashes.size()) {
+        return boost::none;
+    }
+
+    // Hashes are provided in the same (ascending) order in which Assemble added them
+    std::map<uint64_t, mw::Hash> node_hashes;
+    auto hash_iter = segment.hashes.cbegin();
+    for (const Index& idx : hash_indices) {
+        node_hashes.emplace(idx.GetPosition(), *hash_iter++);
+    }
+
+    for (const mmr::Leaf& leaf : segment.leaves) {
+        node_hashes.emplace(leaf.GetNodeIndex().GetPosition(), leaf.GetHash());
+    }
+
+    std::function<boost::optional<mw::Hash>(const Index&)> calc_hash = [&](const Index& idx) -> boost::optional<mw::Hash> {
+        auto iter = node_hashes.find(idx.GetPosition());
+        if (iter != node_hashes.end()) {
+            return iter->second;
+        }
+
+        if (idx.IsLeaf()) {
+            return boost::none;
+        }
+
+        boost::optional<mw::Hash> left_hash = calc_hash(idx.GetLeftChild());
+        boost::optional<mw::Hash> right_hash = left_hash ? calc_hash(idx.GetRightChild()) : boost::none;
+        if (!right_hash) {
+            return boost::none;
+        }
+
+        mw::Hash hash = MMRUtil::CalcParentHash(idx, *left_hash, *right_hash);
+        node_hashes.emplace(idx.GetPosition(), hash);
+        return hash;
+    };
+
+    // The segment must include a lower peak if and only if there are peaks to the right of the last leaf's mountain
+    auto peak_iter = std::find_if(
+        peak_indices.begin(), peak_indices.end(),
+        [&last_leaf_idx](const Index& peak_idx) { return peak_idx >= last_leaf_idx.GetNodeIndex(); });
+    if (peak_iter == peak_indices.end() || (peak_iter + 1 != peak_indices.end()) != bool(segment.lower_peak)) {
+        return boost::none;
+    }
+
+    // Bag the peaks from right to left, starting from the already-bagged lower peak
+    const Index next_node = leafset.GetNextLeafIdx().GetNodeIndex();
+    boost::optional<mw::Hash> root = segment.lower_peak;
+    for (auto iter = std::make_reverse_iterator(peak_iter + 1); iter != peak_indices.rend(); iter++) {
+        boost::optional<mw::Hash> peak_hash = calc_hash(*iter);
+        if (!peak_hash) {
+            return boost::none;
+        }
+
+        root = root ? MMRUtil::CalcParentHash(next_node, *peak_hash, *root) : *peak_hash;
+    }
+
+    return root;
+}
+
 std::set<Index> SegmentFactory::CalcHashIndices(
     const ILeafSet& leafset,
     const std::vector<Index>& peak_indices,
@@ -92,4 +92,56 @@ BOOST_AUTO_TEST_CASE(AssembleSegment)
     BOOST_REQUIRE_EQUAL(root, mmr->Root());
 }
 
+BOOST_AUTO_TEST_CASE(CalcSegmentRoot)
+{
+    auto mmr_with_leafset = BuildDetermininisticMMR(27);
+    auto mmr = mmr_with_leafset.mmr;
+    auto leafset = mmr_with_leafset.leafset;
+    for (uint64_t spent : {1, 4, 5, 6, 7, 12, 20, 26}) {
+        leafset->Remove(mmr::LeafIndex::At(spent));
+    }
+
+    // Every segment covering the unspent leaves must recompute the PMMR root
+    const mw::Hash expected_root = mmr->Root();
+    mmr::LeafIndex first_leaf_idx = mmr::LeafIndex::At(0);
+    while (first_leaf_idx < leafset->GetNextLeafIdx()) {
+        if (!leafset->Contains(first_leaf_idx)) {
+            ++first_leaf_idx;
+            continue;
+        }
+
+        Segment segment = SegmentFactory::Assemble(*mmr, *leafset, first_leaf_idx, 3);
+        BOOST_REQUIRE(!segment.leaves.empty());
+        BOOST_REQUIRE_EQUAL(SegmentFactory::CalcRoot(segment, *leafset, first_leaf_idx), expected_root);
+
+        // A tampered leaf or proof hash must not produce the root
+        Segment bad_leaf = segment;
+        bad_leaf.leaves.front() = mmr::Leaf::Create(first_leaf_idx, {0xff});
+        BOOST_REQUIRE(SegmentFactory::CalcRoot(bad_leaf, *leafset, first_leaf_idx) != expected_root);
+        if (!segment.hashes.empty()) {
+            Segment bad_hash = segment;
+            bad_hash.hashes.back() = mw::Hash{};
+            BOOST_REQUIRE(SegmentFactory::CalcRoot(bad_hash, *leafset, first_leaf_idx) != expected_root);
+        }
+
+        // Omitting a leaf must be detected against the leafset
+        if (segment.leaves.size() > 2) {
+            Segment missing_leaf = segment;
+            missing_leaf.leaves.erase(missing_leaf.leaves.begin() + 1);
+            BOOST_REQUIRE(!SegmentFactory::CalcRoot(missing_leaf, *leafset, first_leaf_idx));
+        }
+
+        first_leaf_idx = segment.leaves.back().GetLeafIndex();
+        ++first_leaf_idx;
+    }
+
+    // The leafset is serialized as its raw bytes in UTXO snapshots
+    std::vector<uint8_t> bytes;
+    for (uint64_t i = 0; i < (leafset->GetNextLeafIdx().Get() + 7) / 8; i++) {
+        bytes.push_back(leafset->GetByte(i));
+    }
+    MemLeafSet mem_leafset(leafset->GetNextLeafIdx(), bytes);
+    BOOST_REQUIRE_EQUAL(mem_leafset.Root(), leafset->Root());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
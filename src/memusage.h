@@ -7,6 +7,7 @@
 
 #include <indirectmap.h>
 #include <prevector.h>
+#include <support/allocators/pool.h>
 
 #include <stdlib.h>
 
@@ -167,6 +168,17 @@ static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+template <class Key, class T, class Hash, class Pred, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const std::unordered_map<Key, T, Hash, Pred, PoolAllocator<std::pair<const Key, T>, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>>& m)
+{
+    // Nodes live in the pool's chunks, which are never shrunk, so count the
+    // chunks (plus their std::list node) rather than the elements. The
+    // bucket array is normally too large for the pool and comes from malloc.
+    const auto* resource = m.get_allocator().resource();
+    const size_t chunk_usage = MallocUsage(resource->ChunkSizeBytes()) + MallocUsage(3 * sizeof(void*));
+    return resource->NumAllocatedChunks() * chunk_usage + MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
 }
 
 #endif // BITCOIN_MEMUSAGE_H
@@ -201,6 +201,10 @@ public:
     CMerkleBlockWithMWEB() { }
     CMerkleBlockWithMWEB(const CBlock& block);
 
+    const CMerkleBlock& GetMerkleBlock() const noexcept { return merkle; }
+    const CTransactionRef& GetHogEx() const noexcept { return hogex; }
+    const mw::Header::CPtr& GetMWEBHeader() const noexcept { return mweb_header; }
+
     SERIALIZE_METHODS(CMerkleBlockWithMWEB, obj) { READWRITE(obj.merkle, obj.hogex, obj.mweb_header); }
 };
 
@@ -21,8 +21,10 @@
 #include <timedata.h>
 #include <util/moneystr.h>
 #include <util/system.h>
+#include <util/time.h>
 
 #include <algorithm>
+#include <tuple>
 #include <utility>
 
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
@@ -91,23 +93,25 @@ void BlockAssembler::resetBlock()
     nBlockWeight = 4000;
     nBlockSigOpsCost = 400;
     nBlockMWEBWeight = 0;
-    fIncludeWitness = false;
-    fIncludeMWEB = false;
 
     // These counters do not include coinbase tx
     nBlockTx = 0;
     nFees = 0;
+
+    m_selection = BlockTemplateSelection{};
 }
 
 Optional<int64_t> BlockAssembler::m_last_block_num_txs{nullopt};
 Optional<int64_t> BlockAssembler::m_last_block_weight{nullopt};
 Optional<int64_t> BlockAssembler::m_last_block_mweb_weight{nullopt};
 
-std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn)
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, BlockTemplateSelection* selection)
 {
     int64_t nTimeStart = GetTimeMicros();
 
     resetBlock();
+    fIncludeWitness = false;
+    fIncludeMWEB = false;
 
     pblocktemplate.reset(new CBlockTemplate());
 
@@ -156,7 +160,29 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
-    addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+    const std::chrono::seconds now = GetTime<std::chrono::seconds>();
+    CTxMemPool::setEntries candidates;
+    const bool reused = selection && ReuseSelection(*selection, pindexPrev->GetBlockHash(), now, candidates);
+    if (reused) {
+        addPackageTxs(nPackagesSelected, nDescendantsUpdated, &candidates);
+    } else {
+        if (selection) {
+            // Start over from an empty block, in case part of the selection was added
+            resetBlock();
+            pblock->vtx.resize(1);
+            pblocktemplate->vTxFees.resize(1);
+            pblocktemplate->vTxSigOpsCost.resize(1);
+            if (fIncludeMWEB) {
+                mweb_miner.NewBlock(nHeight);
+            }
+        }
+        m_selection.full_time = now;
+        addChunkTxs(nPackagesSelected);
+    }
+    if (selection) {
+        // Only keep the selection once the block passed TestBlockValidity()
+        *selection = BlockTemplateSelection{};
+    }
 
     if (fIncludeMWEB) {
         mweb_miner.AddHogExTransaction(pindexPrev, pblock, pblocktemplate.get(), nFees);
@@ -195,11 +221,59 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     }
     int64_t nTime2 = GetTimeMicros();
 
-    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
+    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants%s), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, reused ? strprintf(", %u new candidates", candidates.size()) : "", 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
+
+    if (selection) {
+        m_selection.prev_hash = pindexPrev->GetBlockHash();
+        m_selection.full_selections = m_mempool.GetFullTemplateSelections();
+        m_selection.block_max_weight = nBlockMaxWeight;
+        m_selection.block_min_fee_rate = blockMinFeeRate;
+        m_selection.considered_time = now;
+        *selection = std::move(m_selection);
+    }
 
     return std::move(pblocktemplate);
 }
 
+bool BlockAssembler::ReuseSelection(const BlockTemplateSelection& selection, const uint256& prev_hash, std::chrono::seconds now, CTxMemPool::setEntries& candidates)
+{
+    if (selection.prev_hash.IsNull() || selection.prev_hash != prev_hash) return false;
+    if (selection.full_selections != m_mempool.GetFullTemplateSelections()) return false;
+    if (selection.block_max_weight != nBlockMaxWeight || selection.block_min_fee_rate != blockMinFeeRate) return false;
+    if (now < selection.considered_time || now - selection.full_time >= MAX_TEMPLATE_SELECTION_AGE) return false;
+
+    // Every selected transaction must still be in the mempool. Removing one
+    // also removes its descendants, so the rest of the selection stays valid.
+    std::vector<CTxMemPool::txiter> selected;
+    selected.reserve(selection.txs.size());
+    for (const BlockTemplateSelection::Entry& entry : selection.txs) {
+        CTxMemPool::txiter it = m_mempool.mapTx.find(entry.tx->GetHash());
+        if (it == m_mempool.mapTx.end() || it->GetSharedTx() != entry.tx) return false;
+        selected.push_back(it);
+    }
+    for (size_t i = 0; i < selected.size(); ++i) {
+        if (!AddToBlock(selected[i], selection.txs[i].block_tx)) return false;
+    }
+    m_selection.full_time = selection.full_time;
+    m_selection.block_full = selection.block_full;
+    m_selection.min_package_feerate = selection.min_package_feerate;
+
+    const auto& by_time = m_mempool.mapTx.get<entry_time>();
+    for (auto it = by_time.end(); it != by_time.begin();) {
+        --it;
+        if (it->GetTime() < selection.considered_time) break;
+        CTxMemPool::txiter entry = m_mempool.mapTx.project<0>(it);
+        if (inBlock.count(entry)) continue;
+        // A package that would have to displace selected transactions needs
+        // a selection from scratch
+        if (selection.block_full && CFeeRate(entry->GetModFeesWithAncestors(), entry->GetSizeWithAncestors(), entry->GetMWEBWeightWithAncestors()) > selection.min_package_feerate) {
+            return false;
+        }
+        candidates.insert(entry);
+    }
+    return true;
+}
+
 void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
 {
     for (CTxMemPool::setEntries::iterator iit = testSet.begin(); iit != testSet.end(); ) {
@@ -246,20 +320,22 @@ bool BlockAssembler::TestPackageTransactions(const CTxMemPool::setEntries& packa
     return true;
 }
 
-bool BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
+bool BlockAssembler::AddToBlock(CTxMemPool::txiter iter, CTransactionRef block_tx)
 {
     if (iter->GetTx().HasMWEBTx() && !mweb_miner.AddMWEBTransaction(iter)) {
         return false;
     }
 
-    CTransactionRef pTx = iter->GetSharedTx();
-    if (!pTx->IsMWEBOnly()) {
+    CTransactionRef pTx = std::move(block_tx);
+    if (!pTx && !iter->GetTx().IsMWEBOnly()) {
+        pTx = iter->GetSharedTx();
         if (pTx->HasMWEBTx()) {
             CMutableTransaction mutable_tx(*pTx);
             mutable_tx.mweb_tx.SetNull();
             pTx = MakeTransactionRef(std::move(mutable_tx));
         }
-
+    }
+    if (pTx) {
         pblocktemplate->block.vtx.emplace_back(pTx);
         // MWEB: Should probably recalculate fee (for vTxFees) and sigopcost (for vTxSigOpsCost) without MWEB data?
         // Then we could use actual fee and sigop cost for hogex.
@@ -273,6 +349,7 @@ bool BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
     nBlockMWEBWeight += iter->GetMWEBWeight();
     nFees += iter->GetFee();
     inBlock.insert(iter);
+    m_selection.txs.push_back({iter->GetSharedTx(), std::move(pTx)});
 
     bool fPrintPriority = gArgs.GetBoolArg("-printpriority", DEFAULT_PRINTPRIORITY);
     if (fPrintPriority) {
@@ -285,7 +362,7 @@ bool BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
 }
 
 int BlockAssembler::UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded,
-        indexed_modified_transaction_set &mapModifiedTx)
+        indexed_modified_transaction_set &mapModifiedTx, const CTxMemPool::setEntries* only)
 {
     int nDescendantsUpdated = 0;
     for (CTxMemPool::txiter it : alreadyAdded) {
@@ -293,7 +370,7 @@ int BlockAssembler::UpdatePackagesForAdded(const CTxMemPool::setEntries& already
         m_mempool.CalculateDescendants(it, descendants);
         // Insert all descendants (not yet in block) into the modified set
         for (CTxMemPool::txiter desc : descendants) {
-            if (alreadyAdded.count(desc))
+            if (alreadyAdded.count(desc) || (only && !only->count(desc)))
                 continue;
             ++nDescendantsUpdated;
             modtxiter mit = mapModifiedTx.find(desc);
@@ -348,7 +425,7 @@ void BlockAssembler::SortForBlock(const CTxMemPool::setEntries& package, std::ve
 // Each time through the loop, we compare the best transaction in
 // mapModifiedTxs with the next transaction in the mempool to decide what
 // transaction package to work on next.
-void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated)
+void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated, const CTxMemPool::setEntries* candidates)
 {
     // mapModifiedTx will store sorted packages after they are modified
     // because some of their txs are already in the block
@@ -358,22 +435,44 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
 
     // Start by adding all descendants of previously added txs to mapModifiedTx
     // and modifying them for their already included ancestors
-    UpdatePackagesForAdded(inBlock, mapModifiedTx);
+    UpdatePackagesForAdded(inBlock, mapModifiedTx, candidates);
 
     CTxMemPool::indexed_transaction_set::index<ancestor_score>::type::iterator mi = m_mempool.mapTx.get<ancestor_score>().begin();
     CTxMemPool::txiter iter;
 
+    // When given candidates, walk those by ancestor score instead of mapTx
+    std::vector<CTxMemPool::txiter> sorted_candidates;
+    size_t next_candidate = 0;
+    if (candidates) {
+        sorted_candidates.assign(candidates->begin(), candidates->end());
+        std::sort(sorted_candidates.begin(), sorted_candidates.end(), [](CTxMemPool::txiter a, CTxMemPool::txiter b) {
+            return CompareTxMemPoolEntryByAncestorFee()(*a, *b);
+        });
+    }
+    const auto at_end = [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs) {
+        return candidates ? next_candidate == sorted_candidates.size() : mi == m_mempool.mapTx.get<ancestor_score>().end();
+    };
+    const auto current = [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs) {
+        return candidates ? sorted_candidates[next_candidate] : m_mempool.mapTx.project<0>(mi);
+    };
+    const auto advance = [&] {
+        if (candidates) {
+            ++next_candidate;
+        } else {
+            ++mi;
+        }
+    };
+
     // Limit the number of attempts to add transactions to the block when it is
     // close to full; this is just a simple heuristic to finish quickly if the
     // mempool has a lot of entries.
     const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
     int64_t nConsecutiveFailed = 0;
 
-    while (mi != m_mempool.mapTx.get<ancestor_score>().end() || !mapModifiedTx.empty()) {
+    while (!at_end() || !mapModifiedTx.empty()) {
         // First try to find a new transaction in mapTx to evaluate.
-        if (mi != m_mempool.mapTx.get<ancestor_score>().end() &&
-            SkipMapTxEntry(m_mempool.mapTx.project<0>(mi), mapModifiedTx, failedTx)) {
-            ++mi;
+        if (!at_end() && SkipMapTxEntry(current(), mapModifiedTx, failedTx)) {
+            advance();
             continue;
         }
 
@@ -382,13 +481,13 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
         bool fUsingModified = false;
 
         modtxscoreiter modit = mapModifiedTx.get<ancestor_score>().begin();
-        if (mi == m_mempool.mapTx.get<ancestor_score>().end()) {
+        if (at_end()) {
             // We're out of entries in mapTx; use the entry from mapModifiedTx
             iter = modit->iter;
             fUsingModified = true;
         } else {
             // Try to compare the mapTx entry to the mapModifiedTx entry
-            iter = m_mempool.mapTx.project<0>(mi);
+            iter = current();
             if (modit != mapModifiedTx.get<ancestor_score>().end() &&
                     CompareTxMemPoolEntryByAncestorFee()(*modit, CTxMemPoolModifiedEntry(iter))) {
                 // The best entry in mapModifiedTx has higher score
@@ -399,7 +498,7 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
             } else {
                 // Either no entry in mapModifiedTx, or it's worse than mapTx.
                 // Increment mi for the next loop iteration.
-                ++mi;
+                advance();
             }
         }
 
@@ -424,6 +523,7 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
         }
 
         if (!TestPackage(packageSize, packageSigOpsCost, packageMWEBWeight)) {
+            m_selection.block_full = true;
             if (fUsingModified) {
                 // Since we always look at the best entry in mapModifiedTx,
                 // we must erase failed entries so that we can consider the
@@ -485,12 +585,103 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
         ++nPackagesSelected;
 
         if (!failed) {
+            const CFeeRate package_feerate(packageFees, packageSize, packageMWEBWeight);
+            if (m_selection.min_package_feerate == CFeeRate() || package_feerate < m_selection.min_package_feerate) {
+                m_selection.min_package_feerate = package_feerate;
+            }
+
             // Update transactions that depend on each of these
             nDescendantsUpdated += UpdatePackagesForAdded(ancestors, mapModifiedTx);
         }
     }
 }
 
+// The mempool keeps each cluster of connected transactions linearized into
+// chunks of non-increasing feerate, so the chunks of all clusters sorted by
+// feerate are an order in which every chunk comes after the ones it depends
+// on. When a chunk cannot be added, the rest of its cluster is skipped, as it
+// may depend on that chunk.
+void BlockAssembler::addChunkTxs(int& nPackagesSelected)
+{
+    struct ChunkRef {
+        const CTxMemPool::ClusterChunk* chunk;
+        uint64_t cluster_id;
+        size_t index;
+    };
+    std::vector<ChunkRef> chunks;
+    for (const auto& cluster : m_mempool.GetClusters()) {
+        for (size_t i = 0; i < cluster.second.chunks.size(); ++i) {
+            chunks.push_back({&cluster.second.chunks[i], cluster.first, i});
+        }
+    }
+    std::sort(chunks.begin(), chunks.end(), [](const ChunkRef& a, const ChunkRef& b) {
+        if (HigherFeerate(a.chunk->fee, a.chunk->cluster_size, b.chunk->fee, b.chunk->cluster_size)) return true;
+        if (HigherFeerate(b.chunk->fee, b.chunk->cluster_size, a.chunk->fee, a.chunk->cluster_size)) return false;
+        return std::tie(a.cluster_id, a.index) < std::tie(b.cluster_id, b.index);
+    });
+
+    std::set<uint64_t> failed_clusters;
+    const CTxMemPool::setEntries no_failed_txs;
+
+    // Limit the number of attempts to add transactions to the block when it is
+    // close to full, like addPackageTxs() does.
+    const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
+    int64_t nConsecutiveFailed = 0;
+
+    for (const ChunkRef& ref : chunks) {
+        if (failed_clusters.count(ref.cluster_id)) continue;
+        const CTxMemPool::ClusterChunk& chunk = *ref.chunk;
+
+        // MWEB weight is priced differently by the minimum feerate than by the
+        // chunk order, so check every chunk instead of stopping at the first
+        if (chunk.fee < blockMinFeeRate.GetTotalFee(chunk.size, chunk.mweb_weight)) {
+            failed_clusters.insert(ref.cluster_id);
+            continue;
+        }
+
+        if (!TestPackage(chunk.size, chunk.sigops, chunk.mweb_weight)) {
+            m_selection.block_full = true;
+            failed_clusters.insert(ref.cluster_id);
+
+            ++nConsecutiveFailed;
+
+            if (nConsecutiveFailed > MAX_CONSECUTIVE_FAILURES && nBlockWeight >
+                    nBlockMaxWeight - 4000) {
+                // Give up if we're close to full and haven't succeeded in a while
+                break;
+            }
+            continue;
+        }
+
+        const CTxMemPool::setEntries package(chunk.txs.begin(), chunk.txs.end());
+        if (!TestPackageTransactions(package, no_failed_txs)) {
+            failed_clusters.insert(ref.cluster_id);
+            continue;
+        }
+
+        // This chunk will make it in; reset the failed counter.
+        nConsecutiveFailed = 0;
+
+        bool failed = false;
+        for (CTxMemPool::txiter it : chunk.txs) {
+            failed = !AddToBlock(it);
+            if (failed) {
+                failed_clusters.insert(ref.cluster_id);
+                break;
+            }
+        }
+
+        ++nPackagesSelected;
+
+        if (!failed) {
+            const CFeeRate chunk_feerate(chunk.fee, chunk.size, chunk.mweb_weight);
+            if (m_selection.min_package_feerate == CFeeRate() || chunk_feerate < m_selection.min_package_feerate) {
+                m_selection.min_package_feerate = chunk_feerate;
+            }
+        }
+    }
+}
+
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
 {
     // Update nExtraNonce
@@ -12,6 +12,7 @@
 #include <validation.h>
 #include <mweb/mweb_miner.h>
 
+#include <chrono>
 #include <memory>
 #include <stdint.h>
 
@@ -25,6 +26,8 @@ class CScript;
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Maximum time a block template selection is extended before selecting from the whole mempool again */
+static constexpr std::chrono::seconds MAX_TEMPLATE_SELECTION_AGE{60};
 
 struct CBlockTemplate
 {
@@ -34,6 +37,40 @@ struct CBlockTemplate
     std::vector<unsigned char> vchCoinbaseCommitment;
 };
 
+/**
+ * The transactions selected for a block template, kept between calls to
+ * BlockAssembler::CreateNewBlock() so that the next template on the same tip
+ * can start from them, and only select from the transactions that entered
+ * the mempool since.
+ */
+struct BlockTemplateSelection
+{
+    struct Entry {
+        //! The transaction as it is in the mempool
+        CTransactionRef tx;
+        //! The transaction as it is in the block, without MWEB data. Null for MWEB-only transactions.
+        CTransactionRef block_tx;
+    };
+
+    //! Block the transactions were selected on top of, null if there is no selection
+    uint256 prev_hash;
+    //! CTxMemPool::GetFullTemplateSelections() when the transactions were selected
+    uint64_t full_selections{0};
+    //! Options the transactions were selected with
+    unsigned int block_max_weight{0};
+    CFeeRate block_min_fee_rate;
+    //! Mempool entry time from which on transactions have not been considered yet
+    std::chrono::seconds considered_time{0};
+    //! When the transactions were last selected from the whole mempool
+    std::chrono::seconds full_time{0};
+    //! Selected transactions, in block order
+    std::vector<Entry> txs;
+    //! Whether a package was left out because it did not fit
+    bool block_full{false};
+    //! Lowest ancestor feerate of the packages selected
+    CFeeRate min_package_feerate;
+};
+
 // Container for tracking updates to ancestor feerate as we include (parent)
 // transactions in a block
 struct CTxMemPoolModifiedEntry {
@@ -151,6 +188,8 @@ private:
     uint64_t nBlockMWEBWeight;
     CAmount nFees;
     CTxMemPool::setEntries inBlock;
+    //! Transactions added to the block, for the caller's BlockTemplateSelection
+    BlockTemplateSelection m_selection;
 
     // Chain context for the block
     int nHeight;
@@ -168,8 +207,17 @@ public:
     explicit BlockAssembler(const CTxMemPool& mempool, const CChainParams& params);
     explicit BlockAssembler(const CTxMemPool& mempool, const CChainParams& params, const Options& options);
 
-    /** Construct a new block template with coinbase to scriptPubKeyIn */
-    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn);
+    /** Construct a new block template with coinbase to scriptPubKeyIn
+      *
+      * If `selection` is given and was filled by an earlier call on the same
+      * tip, the transactions selected then are taken over as long as they are
+      * all still in the mempool, and only transactions that entered the mempool
+      * since are selected from. Otherwise, or if those include a package that
+      * may displace selected ones in a full block, or the selection is older
+      * than MAX_TEMPLATE_SELECTION_AGE, or the mempool asked for it with
+      * RequestFullTemplateSelection(), transactions are selected from the
+      * whole mempool. `selection` is updated for the next call. */
+    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, BlockTemplateSelection* selection = nullptr);
 
     static Optional<int64_t> m_last_block_num_txs;
     static Optional<int64_t> m_last_block_weight;
@@ -179,14 +227,25 @@ private:
     // utility functions
     /** Clear the block's state and prepare for assembling a new block */
     void resetBlock();
-    /** Add a tx to the block */
-    bool AddToBlock(CTxMemPool::txiter iter);
+    /** Add a tx to the block. `block_tx` is the transaction as it goes into the block, if known. */
+    bool AddToBlock(CTxMemPool::txiter iter, CTransactionRef block_tx = nullptr);
+    /** Add the transactions of an earlier selection to the block, and collect
+      * the transactions that entered the mempool since into `candidates`.
+      * Returns false if the selection cannot be extended. */
+    bool ReuseSelection(const BlockTemplateSelection& selection, const uint256& prev_hash, std::chrono::seconds now, CTxMemPool::setEntries& candidates) EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs);
 
     // Methods for how to add transactions to a block.
     /** Add transactions based on feerate including unconfirmed ancestors
       * Increments nPackagesSelected / nDescendantsUpdated with corresponding
-      * statistics from the package selection (for logging statistics). */
-    void addPackageTxs(int& nPackagesSelected, int& nDescendantsUpdated) EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs);
+      * statistics from the package selection (for logging statistics).
+      * If `candidates` is given, only packages of those transactions are
+      * considered instead of the whole mempool. */
+    void addPackageTxs(int& nPackagesSelected, int& nDescendantsUpdated, const CTxMemPool::setEntries* candidates = nullptr) EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs);
+
+    /** Add transactions chunk by chunk from the mempool's clusters, in order
+      * of chunk feerate. Increments nPackagesSelected by the number of
+      * chunks selected. */
+    void addChunkTxs(int& nPackagesSelected) EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs);
 
     // helper functions for addPackageTxs()
     /** Remove confirmed (inBlock) entries from given set */
@@ -205,8 +264,9 @@ private:
     void SortForBlock(const CTxMemPool::setEntries& package, std::vector<CTxMemPool::txiter>& sortedEntries);
     /** Add descendants of given transactions to mapModifiedTx with ancestor
       * state updated assuming given transactions are inBlock. Returns number
-      * of updated descendants. */
-    int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set& mapModifiedTx) EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs);
+      * of updated descendants. If `only` is given, other descendants are
+      * left out. */
+    int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set& mapModifiedTx, const CTxMemPool::setEntries* only = nullptr) EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs);
 };
 
 /** Modify the extranonce in a block */
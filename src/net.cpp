@@ -26,6 +26,7 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
 #endif
 
 #if HAVE_DECL_GETIFADDRS && HAVE_DECL_FREEIFADDRS
@@ -105,6 +106,18 @@ enum BindFlags {
 // The sleep time needs to be small to avoid new sockets stalling
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
+#ifndef WIN32
+/** Maximum number of send queue buffers passed to a single sendmsg() */
+static constexpr int MAX_SEND_IOVECS = 64;
+#endif
+
+#ifdef USE_EPOLL
+/** Set in the tag of the events of listening sockets, next to their index; nodes are tagged with their id */
+static constexpr uint64_t EPOLL_LISTEN_TAG = uint64_t{1} << 63;
+/** Maximum number of events handled per epoll_wait() */
+static constexpr int EPOLL_MAX_EVENTS = 256;
+#endif
+
 const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
@@ -794,11 +807,11 @@ Optional<CNetMessage> V1TransportDeserializer::GetMessage(const std::chrono::mic
 }
 
 void V1TransportSerializer::prepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) {
-    // create dbl-sha256 checksum
-    uint256 hash = Hash(msg.data);
+    // create dbl-sha256 checksum, which shared payloads come with
+    uint256 hash = msg.m_shared_payload ? msg.m_shared_payload->GetHash() : Hash(msg.data);
 
     // create header
-    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.data.size());
+    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.Payload().size());
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
     // serialize header
@@ -812,27 +825,53 @@ size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pno
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert(it->size() > pnode->nSendOffset);
+        size_t nToSend = 0;
         int nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            nToSend = it->size() - pnode->nSendOffset;
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(it->data()) + pnode->nSendOffset, nToSend, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            // Hand the queued buffers to the kernel in one call, without
+            // copying them into a contiguous buffer first
+            struct iovec iov[MAX_SEND_IOVECS];
+            int iovcnt = 0;
+            for (auto buf = it; buf != pnode->vSendMsg.end() && iovcnt < MAX_SEND_IOVECS; ++buf, ++iovcnt) {
+                const size_t offset = iovcnt == 0 ? pnode->nSendOffset : 0;
+                iov[iovcnt].iov_base = const_cast<unsigned char*>(buf->data()) + offset;
+                iov[iovcnt].iov_len = buf->size() - offset;
+                nToSend += iov[iovcnt].iov_len;
+            }
+            struct msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iovcnt;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // Drop the buffers that were sent completely
+            size_t nRemaining = nBytes;
+            while (nRemaining > 0) {
+                const size_t nLeft = it->size() - pnode->nSendOffset;
+                if (nRemaining < nLeft) {
+                    pnode->nSendOffset += nRemaining;
+                    break;
+                }
+                nRemaining -= nLeft;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= it->size();
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < nToSend) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -1155,6 +1194,9 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+#ifdef USE_EPOLL
+        RegisterNodeSocket(pnode);
+#endif
     }
 
     // We received a new connection, harvest entropy from the time (and our peer count)
@@ -1224,6 +1266,11 @@ void CConnman::DisconnectNodes()
                 // release outbound grant (if any)
                 pnode->grantOutbound.Release();
 
+#ifdef USE_EPOLL
+                // closing the socket removes it from m_epoll
+                m_epoll_nodes.erase(pnode->GetId());
+#endif
+
                 // close socket and cleanup
                 pnode->CloseSocketDisconnect();
 
@@ -1467,6 +1514,64 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 }
 #endif
 
+bool CConnman::SocketRecvData(CNode* pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = 0;
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            return false;
+        nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    }
+    if (nBytes > 0)
+    {
+        bool notify = false;
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+            pnode->CloseSocketDisconnect();
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                // vRecvMsg contains only completed CNetMessage
+                // the single possible partially deserialized message are held by TransportDeserializer
+                nSizeAdded += it->m_raw_message_size;
+            }
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+            }
+            WakeMessageHandler();
+        }
+        return nBytes == (int)sizeof(pchBuf);
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect) {
+            LogPrint(BCLog::NET, "socket closed for peer=%d\n", pnode->GetId());
+        }
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect) {
+                LogPrint(BCLog::NET, "socket recv error for peer=%d: %s\n", pnode->GetId(), NetworkErrorString(nErr));
+            }
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return false;
+}
+
 void CConnman::SocketHandler()
 {
     std::set<SOCKET> recv_set, send_set, error_set;
@@ -1516,58 +1621,7 @@ void CConnman::SocketHandler()
         }
         if (recvSet || errorSet)
         {
-            // typical socket buffer is 8K-64K
-            char pchBuf[0x10000];
-            int nBytes = 0;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-            }
-            if (nBytes > 0)
-            {
-                bool notify = false;
-                if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
-                    pnode->CloseSocketDisconnect();
-                RecordBytesRecv(nBytes);
-                if (notify) {
-                    size_t nSizeAdded = 0;
-                    auto it(pnode->vRecvMsg.begin());
-                    for (; it != pnode->vRecvMsg.end(); ++it) {
-                        // vRecvMsg contains only completed CNetMessage
-                        // the single possible partially deserialized message are held by TransportDeserializer
-                        nSizeAdded += it->m_raw_message_size;
-                    }
-                    {
-                        LOCK(pnode->cs_vProcessMsg);
-                        pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                        pnode->nProcessQueueSize += nSizeAdded;
-                        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                    }
-                    WakeMessageHandler();
-                }
-            }
-            else if (nBytes == 0)
-            {
-                // socket closed gracefully
-                if (!pnode->fDisconnect) {
-                    LogPrint(BCLog::NET, "socket closed for peer=%d\n", pnode->GetId());
-                }
-                pnode->CloseSocketDisconnect();
-            }
-            else if (nBytes < 0)
-            {
-                // error
-                int nErr = WSAGetLastError();
-                if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                {
-                    if (!pnode->fDisconnect) {
-                        LogPrint(BCLog::NET, "socket recv error for peer=%d: %s\n", pnode->GetId(), NetworkErrorString(nErr));
-                    }
-                    pnode->CloseSocketDisconnect();
-                }
-            }
+            SocketRecvData(pnode);
         }
 
         //
@@ -1591,12 +1645,179 @@ void CConnman::SocketHandler()
     }
 }
 
+#ifdef USE_EPOLL
+EpollSocketEvents::EpollSocketEvents() : m_epoll_fd(epoll_create1(EPOLL_CLOEXEC)) {}
+
+EpollSocketEvents::~EpollSocketEvents()
+{
+    if (m_epoll_fd != -1) {
+        close(m_epoll_fd);
+    }
+}
+
+bool EpollSocketEvents::Add(SOCKET socket, uint64_t tag, uint32_t events)
+{
+    struct epoll_event event{};
+    event.events = events;
+    event.data.u64 = tag;
+    return epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, socket, &event) == 0;
+}
+
+bool EpollSocketEvents::Remove(SOCKET socket)
+{
+    struct epoll_event event{};
+    return epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, socket, &event) == 0;
+}
+
+int EpollSocketEvents::Wait(struct epoll_event* events, int max_events, int timeout_ms)
+{
+    const int num_events = epoll_wait(m_epoll_fd, events, max_events, timeout_ms);
+    if (num_events < 0 && errno == EINTR) return 0;
+    return num_events;
+}
+
+void CConnman::RegisterNodeSocket(CNode* pnode)
+{
+    if (!m_epoll) return;
+
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET) return;
+    // Edge-triggered: an event is only reported when the socket becomes
+    // readable or writable, so the socket handler keeps track of which nodes
+    // still have data waiting.
+    if (!m_epoll->Add(pnode->hSocket, pnode->GetId(), EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET)) {
+        LogPrintf("Unable to add socket of peer=%d to epoll: %s\n", pnode->GetId(), NetworkErrorString(WSAGetLastError()));
+        pnode->fDisconnect = true;
+        return;
+    }
+    m_epoll_nodes.emplace(pnode->GetId(), pnode);
+}
+
+void CConnman::SocketHandlerEpoll()
+{
+    // Do not wait if nodes still have data to receive from the last round
+    m_epoll_events.resize(EPOLL_MAX_EVENTS);
+    const int num_events = m_epoll->Wait(m_epoll_events.data(), m_epoll_events.size(), m_epoll_more_work ? 0 : SELECT_TIMEOUT_MILLISECONDS);
+
+    if (interruptNet) return;
+
+    if (num_events < 0) {
+        LogPrintf("socket epoll error %s\n", NetworkErrorString(WSAGetLastError()));
+        interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        return;
+    }
+
+    //
+    // Accept new connections, and note which nodes are ready
+    //
+    std::set<NodeId> send_ready;
+    for (int i = 0; i < num_events; ++i) {
+        const struct epoll_event& event = m_epoll_events[i];
+        if (event.data.u64 & EPOLL_LISTEN_TAG) {
+            const size_t index = event.data.u64 & ~EPOLL_LISTEN_TAG;
+            if (index < vhListenSocket.size() && vhListenSocket[index].socket != INVALID_SOCKET) {
+                AcceptConnection(vhListenSocket[index]);
+            }
+            continue;
+        }
+        const NodeId id = event.data.u64;
+        if (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) {
+            m_epoll_recv_ready.insert(id);
+        }
+        if (event.events & EPOLLOUT) {
+            send_ready.insert(id);
+        }
+    }
+
+    // Once a second, go over all nodes to check for inactivity, and retry
+    // sends that did not get an event.
+    const int64_t now = GetSystemTimeInSeconds();
+    const bool sweep = now != m_epoll_last_sweep;
+    if (sweep) m_epoll_last_sweep = now;
+
+    std::vector<CNode*> vNodesCopy;
+    {
+        LOCK(cs_vNodes);
+        if (sweep) {
+            vNodesCopy = vNodes;
+        } else {
+            std::set<NodeId> ready = send_ready;
+            ready.insert(m_epoll_recv_ready.begin(), m_epoll_recv_ready.end());
+            for (const NodeId id : ready) {
+                auto it = m_epoll_nodes.find(id);
+                if (it != m_epoll_nodes.end()) vNodesCopy.push_back(it->second);
+            }
+        }
+        for (CNode* pnode : vNodesCopy)
+            pnode->AddRef();
+
+        // Forget nodes that were disconnected
+        for (auto it = m_epoll_recv_ready.begin(); it != m_epoll_recv_ready.end();) {
+            it = m_epoll_nodes.count(*it) ? std::next(it) : m_epoll_recv_ready.erase(it);
+        }
+    }
+
+    //
+    // Service each ready socket
+    //
+    bool more_work = false;
+    for (CNode* pnode : vNodesCopy)
+    {
+        if (interruptNet)
+            break;
+
+        const NodeId id = pnode->GetId();
+        bool send_pending = WITH_LOCK(pnode->cs_vSend, return !pnode->vSendMsg.empty());
+
+        //
+        // Send
+        //
+        if (send_pending && (sweep || send_ready.count(id))) {
+            LOCK(pnode->cs_vSend);
+            size_t nBytes = SocketSendData(pnode);
+            if (nBytes) {
+                RecordBytesSent(nBytes);
+            }
+            send_pending = !pnode->vSendMsg.empty();
+        }
+
+        //
+        // Receive
+        //
+        // As in SocketHandler(), drain the send queue before receiving more.
+        // Nodes that cannot receive yet stay ready until they can.
+        auto it = m_epoll_recv_ready.find(id);
+        if (it != m_epoll_recv_ready.end() && !send_pending && !pnode->fPauseRecv) {
+            if (SocketRecvData(pnode)) {
+                more_work = true;
+            } else {
+                m_epoll_recv_ready.erase(it);
+            }
+        }
+
+        if (sweep) InactivityCheck(pnode);
+    }
+    m_epoll_more_work = more_work;
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodesCopy)
+            pnode->Release();
+    }
+}
+#endif
+
 void CConnman::ThreadSocketHandler()
 {
     while (!interruptNet)
     {
         DisconnectNodes();
         NotifyNumConnectionsChanged();
+#ifdef USE_EPOLL
+        if (m_epoll) {
+            SocketHandlerEpoll();
+            continue;
+        }
+#endif
         SocketHandler();
     }
 }
@@ -2245,6 +2466,9 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+#ifdef USE_EPOLL
+        RegisterNodeSocket(pnode);
+#endif
     }
 }
 
@@ -2510,6 +2734,20 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         return false;
     }
 
+#ifdef USE_EPOLL
+    if (m_use_epoll) {
+        m_epoll = MakeUnique<EpollSocketEvents>();
+        bool registered = m_epoll->IsValid();
+        for (size_t i = 0; registered && i < vhListenSocket.size(); ++i) {
+            registered = m_epoll->Add(vhListenSocket[i].socket, EPOLL_LISTEN_TAG | i, EPOLLIN);
+        }
+        if (!registered) {
+            LogPrintf("Unable to set up epoll: %s, using poll instead\n", NetworkErrorString(WSAGetLastError()));
+            m_epoll.reset();
+        }
+    }
+#endif
+
     for (const auto& strDest : connOptions.vSeedNodes) {
         AddAddrFetch(strDest);
     }
@@ -2684,6 +2922,11 @@ void CConnman::StopNodes()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+#ifdef USE_EPOLL
+    m_epoll_nodes.clear();
+    m_epoll_recv_ready.clear();
+    m_epoll.reset();
+#endif
     semOutbound.reset();
     semAddnode.reset();
 }
@@ -3041,7 +3284,7 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
+    size_t nMessageSize = msg.Payload().size();
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.m_type), nMessageSize, pnode->GetId());
 
     // make sure we use the appropriate network transport format
@@ -3060,9 +3303,14 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.emplace_back(std::move(serializedHeader));
+        if (nMessageSize) {
+            if (msg.m_shared_payload) {
+                pnode->vSendMsg.emplace_back(std::move(msg.m_shared_payload));
+            } else {
+                pnode->vSendMsg.emplace_back(std::move(msg.data));
+            }
+        }
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
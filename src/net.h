@@ -20,6 +20,7 @@
 #include <policy/feerate.h>
 #include <protocol.h>
 #include <random.h>
+#include <span.h>
 #include <streams.h>
 #include <sync.h>
 #include <threadinterrupt.h>
@@ -29,6 +30,7 @@
 #include <cstdint>
 #include <deque>
 #include <map>
+#include <unordered_map>
 #include <thread>
 #include <memory>
 #include <condition_variable>
@@ -37,6 +39,10 @@
 #include <arpa/inet.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 
 class CScheduler;
 class CNode;
@@ -91,6 +97,50 @@ static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
 typedef int64_t NodeId;
 
+#ifdef USE_EPOLL
+/** Default for -socketevents: use epoll where it is available */
+static const bool DEFAULT_USE_EPOLL = true;
+#else
+static const bool DEFAULT_USE_EPOLL = false;
+#endif
+
+#ifdef USE_EPOLL
+/**
+ * Owns an epoll instance. Sockets are registered once, with a tag that is
+ * handed back with every event for them, instead of being passed to the
+ * kernel again on every wait as with select() or poll().
+ *
+ * A socket is removed from the instance when it is closed, so closing it is
+ * enough to unregister it.
+ */
+class EpollSocketEvents
+{
+public:
+    EpollSocketEvents();
+    ~EpollSocketEvents();
+
+    EpollSocketEvents(const EpollSocketEvents&) = delete;
+    EpollSocketEvents& operator=(const EpollSocketEvents&) = delete;
+
+    //! Whether the epoll instance could be created
+    bool IsValid() const { return m_epoll_fd != -1; }
+
+    //! Register `socket` for `events` (EPOLLIN, EPOLLOUT, EPOLLET, ...)
+    bool Add(SOCKET socket, uint64_t tag, uint32_t events);
+    bool Remove(SOCKET socket);
+
+    /**
+     * Wait up to `timeout_ms` milliseconds for events, and store at most
+     * `max_events` of them in `events`. Returns the number of events, or -1
+     * on error.
+     */
+    int Wait(struct epoll_event* events, int max_events, int timeout_ms);
+
+private:
+    int m_epoll_fd;
+};
+#endif
+
 struct AddedNodeInfo
 {
     std::string strAddedNode;
@@ -102,6 +152,27 @@ struct AddedNodeInfo
 class CNodeStats;
 class CClientUIInterface;
 
+/**
+ * A serialized message payload that is sent to several peers, such as a
+ * block. It is serialized and hashed once, and each peer's send queue only
+ * holds a reference to it.
+ */
+class CSharedNetMsgPayload
+{
+public:
+    explicit CSharedNetMsgPayload(std::vector<unsigned char> data) : m_data(std::move(data)), m_hash(Hash(m_data)) {}
+
+    const std::vector<unsigned char>& Data() const { return m_data; }
+    //! Double-SHA256 of the payload, from which the message checksum is taken
+    const uint256& GetHash() const { return m_hash; }
+
+private:
+    const std::vector<unsigned char> m_data;
+    const uint256 m_hash;
+};
+
+using SharedNetMsgPayloadRef = std::shared_ptr<const CSharedNetMsgPayload>;
+
 struct CSerializedNetMsg
 {
     CSerializedNetMsg() = default;
@@ -113,6 +184,25 @@ struct CSerializedNetMsg
 
     std::vector<unsigned char> data;
     std::string m_type;
+    //! If set, the payload of the message, in place of data
+    SharedNetMsgPayloadRef m_shared_payload;
+
+    Span<const unsigned char> Payload() const { return m_shared_payload ? MakeSpan(m_shared_payload->Data()) : MakeSpan(data); }
+};
+
+/** A buffer in a node's send queue, which either owns its data or references a shared payload */
+class CSendBuffer
+{
+public:
+    explicit CSendBuffer(std::vector<unsigned char> data) : m_data(std::move(data)) {}
+    explicit CSendBuffer(SharedNetMsgPayloadRef payload) : m_shared_payload(std::move(payload)) {}
+
+    const unsigned char* data() const { return m_shared_payload ? m_shared_payload->Data().data() : m_data.data(); }
+    size_t size() const { return m_shared_payload ? m_shared_payload->Data().size() : m_data.size(); }
+
+private:
+    std::vector<unsigned char> m_data;
+    SharedNetMsgPayloadRef m_shared_payload;
 };
 
 /** Different types of connections to a peer. This enum encapsulates the
@@ -221,6 +311,7 @@ public:
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
         std::vector<bool> m_asmap;
+        bool m_use_epoll = DEFAULT_USE_EPOLL;
     };
 
     void Init(const Options& connOptions) {
@@ -250,6 +341,7 @@ public:
             vAddedNodes = connOptions.m_added_nodes;
         }
         m_onion_binds = connOptions.onion_binds;
+        m_use_epoll = connOptions.m_use_epoll;
     }
 
     CConnman(uint64_t seed0, uint64_t seed1, bool network_active = true);
@@ -446,6 +538,14 @@ private:
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketHandler();
+    /** Receive from pnode's socket. Returns true if the receive buffer was filled, so more data may be waiting. */
+    bool SocketRecvData(CNode* pnode);
+#ifdef USE_EPOLL
+    /** Add a node that was just added to vNodes to the epoll instance. */
+    void RegisterNodeSocket(CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(cs_vNodes);
+    /** Like SocketHandler(), but only services the sockets epoll reported as ready. */
+    void SocketHandlerEpoll();
+#endif
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
 
@@ -521,6 +621,25 @@ private:
     std::atomic<NodeId> nLastNodeId{0};
     unsigned int nPrevNodeCount{0};
 
+    bool m_use_epoll{DEFAULT_USE_EPOLL};
+#ifdef USE_EPOLL
+    /** Set up in Start() if m_use_epoll, with the listening sockets and every node registered. */
+    std::unique_ptr<EpollSocketEvents> m_epoll;
+    /** Nodes registered with m_epoll, by the tag of their events */
+    std::unordered_map<NodeId, CNode*> m_epoll_nodes GUARDED_BY(cs_vNodes);
+    /**
+     * Nodes whose socket may have data to receive. Sockets are registered
+     * edge-triggered, so a node stays here until a receive comes up short.
+     * Only used by the socket handler thread.
+     */
+    std::set<NodeId> m_epoll_recv_ready;
+    std::vector<struct epoll_event> m_epoll_events;
+    /** Whether the last SocketHandlerEpoll() left nodes with data to receive */
+    bool m_epoll_more_work{false};
+    /** Time of the last InactivityCheck() of all nodes */
+    int64_t m_epoll_last_sweep{0};
+#endif
+
     /**
      * Cache responses to addr requests to minimize privacy leak.
      * Attack example: scraping addrs in real-time may allow an attacker
@@ -866,7 +985,7 @@ public:
     size_t nSendSize{0}; // total size of all vSendMsg entries
     size_t nSendOffset{0}; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    std::deque<CSendBuffer> vSendMsg GUARDED_BY(cs_vSend);
     RecursiveMutex cs_vSend;
     RecursiveMutex cs_hSocket;
     RecursiveMutex cs_vRecv;
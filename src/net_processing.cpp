@@ -17,6 +17,7 @@
 #include <mw/mmr/Segment.h>
 #include <netbase.h>
 #include <netmessagemaker.h>
+#include <node/serializedblockcache.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <primitives/block.h>
@@ -32,6 +33,7 @@
 #include <util/system.h>
 #include <validation.h>
 
+#include <functional>
 #include <memory>
 #include <typeinfo>
 
@@ -1215,12 +1217,14 @@ static bool BlockRequestAllowed(const CBlockIndex* pindex, const Consensus::Para
 }
 
 PeerManager::PeerManager(const CChainParams& chainparams, CConnman& connman, BanMan* banman,
-                         CScheduler& scheduler, ChainstateManager& chainman, CTxMemPool& pool)
+                         CScheduler& scheduler, ChainstateManager& chainman, CTxMemPool& pool,
+                         SerializedBlockCache* block_cache)
     : m_chainparams(chainparams),
       m_connman(connman),
       m_banman(banman),
       m_chainman(chainman),
       m_mempool(pool),
+      m_block_cache(block_cache),
       m_stale_tip_check_time(0)
 {
     // Initialize global variables that cannot be constructed at startup.
@@ -1327,6 +1331,26 @@ static uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
 static bool fWitnessesPresentInMostRecentCompactBlock GUARDED_BY(cs_most_recent_block);
 static bool fMWEBPresentInMostRecentCompactBlock GUARDED_BY(cs_most_recent_block);
 
+/** Get the payload of a message about a block from block_cache, or make it if it is not cached. */
+static SharedNetMsgPayloadRef GetBlockPayload(SerializedBlockCache* block_cache, const uint256& block_hash, const std::string& msg_type, int ser_version, const std::function<SharedNetMsgPayloadRef()>& make_payload)
+{
+    return block_cache ? block_cache->GetOrMake(block_hash, msg_type, ser_version, make_payload) : make_payload();
+}
+
+/**
+ * Make a message about the block block_hash, which serializes obj unless it is in block_cache.
+ * Block messages serialize the same for every peer version, so they are
+ * always made and cached with PROTOCOL_VERSION.
+ */
+template <typename T>
+static CSerializedNetMsg MakeBlockMsg(SerializedBlockCache* block_cache, int nFlags, const std::string& msg_type, const uint256& block_hash, const T& obj)
+{
+    const CNetMsgMaker blockMsgMaker(PROTOCOL_VERSION);
+    return CNetMsgMaker::MakeShared(msg_type, GetBlockPayload(block_cache, block_hash, msg_type, nFlags | blockMsgMaker.GetVersion(), [&] {
+        return blockMsgMaker.MakePayload(nFlags, obj);
+    }));
+}
+
 /**
  * Maintain state about the best-seen block and fast-announce a compact block
  * to compatible peers.
@@ -1355,10 +1379,16 @@ void PeerManager::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_
         fMWEBPresentInMostRecentCompactBlock = mweb_enabled;
     }
 
+    if (m_block_cache) {
+        // Serialize the block in the forms peers ask for before they do
+        m_block_cache->FillAsync(pblock, {PROTOCOL_VERSION | SERIALIZE_NO_MWEB,
+                                          PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS | SERIALIZE_NO_MWEB,
+                                          PROTOCOL_VERSION});
+    }
+
     m_connman.ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, mweb_enabled, &hashBlock](CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
         AssertLockHeld(::cs_main);
 
-        // TODO: Avoid the repeated-serialization here
         if (pnode->GetCommonVersion() < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -1376,7 +1406,7 @@ void PeerManager::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_
 
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerManager::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
-            m_connman.PushMessage(pnode, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            m_connman.PushMessage(pnode, MakeBlockMsg(m_block_cache, nSendFlags, NetMsgType::CMPCTBLOCK, hashBlock, *pcmpctblock));
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -1582,7 +1612,7 @@ static void ActivateBestChainIfNeeded(const CChainParams& chainparams, const CIn
     }
 }
 
-void static ProcessGetBlockData(CNode& pfrom, const CChainParams& chainparams, const CInv& inv, CConnman& connman)
+void static ProcessGetBlockData(CNode& pfrom, const CChainParams& chainparams, const CInv& inv, CConnman& connman, SerializedBlockCache* block_cache)
 {
     bool send = false;
     std::shared_ptr<const CBlock> a_recent_block;
@@ -1635,8 +1665,29 @@ void static ProcessGetBlockData(CNode& pfrom, const CChainParams& chainparams, c
     // it's available before trying to send.
     if (send && (pindex->nStatus & BLOCK_HAVE_DATA))
     {
+        const uint256& hash = pindex->GetBlockHash();
+        // Serialization flags of the block, if inv asks for the full block
+        Optional<int> block_flags;
+        if (inv.IsMsgBlk()) {
+            block_flags = SERIALIZE_TRANSACTION_NO_WITNESS | SERIALIZE_NO_MWEB;
+        } else if (inv.IsMsgWitnessBlk()) {
+            block_flags = SERIALIZE_NO_MWEB;
+        } else if (inv.IsMsgMWEBBlk()) {
+            block_flags = 0;
+        }
+
+        // A block serializes the same for every peer version, so it is
+        // cached under PROTOCOL_VERSION, as NewPoWValidBlock fills it
+        const CNetMsgMaker blockMsgMaker(PROTOCOL_VERSION);
         std::shared_ptr<const CBlock> pblock;
-        if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
+        SharedNetMsgPayloadRef block_payload;
+        if (block_flags && block_cache) {
+            // Blocks served recently need not be read from disk again
+            block_payload = block_cache->Get(hash, NetMsgType::BLOCK, *block_flags | blockMsgMaker.GetVersion());
+        }
+        if (block_payload) {
+            // Don't set pblock as we're sending the cached block
+        } else if (a_recent_block && a_recent_block->GetHash() == hash) {
             pblock = a_recent_block;
         } else if (inv.IsMsgMWEBBlk()) {
             // Fast-path: in this case it is possible to serve the block directly from disk,
@@ -1645,8 +1696,8 @@ void static ProcessGetBlockData(CNode& pfrom, const CChainParams& chainparams, c
             if (!ReadRawBlockFromDisk(block_data, pindex, chainparams.MessageStart())) {
                 assert(!"cannot load block from disk");
             }
-            connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
-            // Don't set pblock as we've sent the block
+            block_payload = std::make_shared<const CSharedNetMsgPayload>(std::move(block_data));
+            if (block_cache) block_cache->Add(hash, NetMsgType::BLOCK, blockMsgMaker.GetVersion(), block_payload);
         } else {
             // Send block from disk
             std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
@@ -1654,14 +1705,14 @@ void static ProcessGetBlockData(CNode& pfrom, const CChainParams& chainparams, c
                 assert(!"cannot load block from disk");
             pblock = pblockRead;
         }
-        if (pblock) {
-            if (inv.IsMsgBlk()) {
-                connman.PushMessage(&pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS | SERIALIZE_NO_MWEB, NetMsgType::BLOCK, *pblock));
-            } else if (inv.IsMsgWitnessBlk()) {
-                connman.PushMessage(&pfrom, msgMaker.Make(SERIALIZE_NO_MWEB, NetMsgType::BLOCK, *pblock));
-            } else if (inv.IsMsgMWEBBlk()) {
-                connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
-            } else if (inv.IsMsgFilteredBlk()) {
+        if (block_flags && !block_payload) {
+            block_payload = blockMsgMaker.MakePayload(*block_flags, *pblock);
+            if (block_cache) block_cache->Add(hash, NetMsgType::BLOCK, *block_flags | blockMsgMaker.GetVersion(), block_payload);
+        }
+        if (block_payload) {
+            connman.PushMessage(&pfrom, CNetMsgMaker::MakeShared(NetMsgType::BLOCK, std::move(block_payload)));
+        } else if (pblock) {
+            if (inv.IsMsgFilteredBlk()) {
                 bool sendMerkleBlock = false;
                 CMerkleBlock merkleBlock;
                 if (pfrom.m_tx_relay != nullptr) {
@@ -1697,18 +1748,22 @@ void static ProcessGetBlockData(CNode& pfrom, const CChainParams& chainparams, c
 
                 if (CanDirectFetch(consensusParams) && pindex->nHeight >= ::ChainActive().Height() - MAX_CMPCTBLOCK_DEPTH) {
                     if ((fPeerWantsWitness || !fWitnessesPresentInARecentCompactBlock) && (fPeerWantsMWEB || !fMWEBPresentInARecentCompactBlock) && a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
-                        connman.PushMessage(&pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
+                        connman.PushMessage(&pfrom, MakeBlockMsg(block_cache, nSendFlags, NetMsgType::CMPCTBLOCK, hash, *a_recent_compact_block));
                     } else {
-                        CBlockHeaderAndShortTxIDs cmpctblock(*pblock, fPeerWantsWitness);
-                        connman.PushMessage(&pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
+                        SharedNetMsgPayloadRef payload = GetBlockPayload(block_cache, hash, NetMsgType::CMPCTBLOCK, nSendFlags | blockMsgMaker.GetVersion(), [&] {
+                            return blockMsgMaker.MakePayload(nSendFlags, CBlockHeaderAndShortTxIDs(*pblock, fPeerWantsWitness));
+                        });
+                        connman.PushMessage(&pfrom, CNetMsgMaker::MakeShared(NetMsgType::CMPCTBLOCK, std::move(payload)));
                     }
                 } else {
-                    connman.PushMessage(&pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCK, *pblock));
+                    connman.PushMessage(&pfrom, MakeBlockMsg(block_cache, nSendFlags, NetMsgType::BLOCK, hash, *pblock));
                 }
             } else if (inv.IsMsgMWEBHeader()) {
                 if (pblock->GetHogEx() != nullptr && !pblock->mweb_block.IsNull()) {
-                    CMerkleBlockWithMWEB merkle_block_with_mweb(*pblock);
-                    connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::MWEBHEADER, merkle_block_with_mweb));
+                    SharedNetMsgPayloadRef payload = GetBlockPayload(block_cache, hash, NetMsgType::MWEBHEADER, blockMsgMaker.GetVersion(), [&] {
+                        return blockMsgMaker.MakePayload(0, CMerkleBlockWithMWEB(*pblock));
+                    });
+                    connman.PushMessage(&pfrom, CNetMsgMaker::MakeShared(NetMsgType::MWEBHEADER, std::move(payload)));
                 }
             }
         }
@@ -1959,7 +2014,7 @@ static CTransactionRef FindTxForGetData(const CTxMemPool& mempool, const CNode&
     return {};
 }
 
-void static ProcessGetData(CNode& pfrom, Peer& peer, const ChainstateManager& chainman, const CChainParams& chainparams, CConnman& connman, CTxMemPool& mempool, const std::atomic<bool>& interruptMsgProc) EXCLUSIVE_LOCKS_REQUIRED(!cs_main, peer.m_getdata_requests_mutex)
+void static ProcessGetData(CNode& pfrom, Peer& peer, const ChainstateManager& chainman, const CChainParams& chainparams, CConnman& connman, CTxMemPool& mempool, SerializedBlockCache* block_cache, const std::atomic<bool>& interruptMsgProc) EXCLUSIVE_LOCKS_REQUIRED(!cs_main, peer.m_getdata_requests_mutex)
 {
     AssertLockNotHeld(cs_main);
 
@@ -2026,7 +2081,7 @@ void static ProcessGetData(CNode& pfrom, Peer& peer, const ChainstateManager& ch
     if (it != peer.m_getdata_requests.end() && !pfrom.fPauseSend) {
         const CInv &inv = *it++;
         if (inv.IsGenBlkMsg()) {
-            ProcessGetBlockData(pfrom, chainparams, inv, connman);
+            ProcessGetBlockData(pfrom, chainparams, inv, connman, block_cache);
         } else if (inv.IsMsgMWEBLeafset()) {
             ProcessGetMWEBLeafset(pfrom, chainman, chainparams, inv, connman);
         }
@@ -3093,7 +3148,7 @@ void PeerManager::ProcessMessage(CNode& pfrom, const std::string& msg_type, CDat
         {
             LOCK(peer->m_getdata_requests_mutex);
             peer->m_getdata_requests.insert(peer->m_getdata_requests.end(), vInv.begin(), vInv.end());
-            ProcessGetData(pfrom, *peer, m_chainman, m_chainparams, m_connman, m_mempool, interruptMsgProc);
+            ProcessGetData(pfrom, *peer, m_chainman, m_chainparams, m_connman, m_mempool, m_block_cache, interruptMsgProc);
         }
 
         return;
@@ -4190,7 +4245,7 @@ bool PeerManager::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgP
     {
         LOCK(peer->m_getdata_requests_mutex);
         if (!peer->m_getdata_requests.empty()) {
-            ProcessGetData(*pfrom, *peer, m_chainman, m_chainparams, m_connman, m_mempool, interruptMsgProc);
+            ProcessGetData(*pfrom, *peer, m_chainman, m_chainparams, m_connman, m_mempool, m_block_cache, interruptMsgProc);
         }
     }
 
@@ -4608,25 +4663,30 @@ bool PeerManager::SendMessages(CNode* pto)
                     int nSendFlags = state.fWantsCmpctWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
                     nSendFlags |= state.fWantsCmpctMWEB ? 0 : SERIALIZE_NO_MWEB;
 
+                    const CNetMsgMaker blockMsgMaker(PROTOCOL_VERSION);
                     bool fGotBlockFromCache = false;
                     {
                         LOCK(cs_most_recent_block);
                         if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
                             if (state.fWantsCmpctWitness || !fWitnessesPresentInMostRecentCompactBlock)
-                                m_connman.PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
+                                m_connman.PushMessage(pto, MakeBlockMsg(m_block_cache, nSendFlags, NetMsgType::CMPCTBLOCK, most_recent_block_hash, *most_recent_compact_block));
                             else {
-                                CBlockHeaderAndShortTxIDs cmpctblock(*most_recent_block, state.fWantsCmpctWitness);
-                                m_connman.PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
+                                SharedNetMsgPayloadRef payload = GetBlockPayload(m_block_cache, most_recent_block_hash, NetMsgType::CMPCTBLOCK, nSendFlags | blockMsgMaker.GetVersion(), [&] {
+                                    return blockMsgMaker.MakePayload(nSendFlags, CBlockHeaderAndShortTxIDs(*most_recent_block, state.fWantsCmpctWitness));
+                                });
+                                m_connman.PushMessage(pto, CNetMsgMaker::MakeShared(NetMsgType::CMPCTBLOCK, std::move(payload)));
                             }
                             fGotBlockFromCache = true;
                         }
                     }
                     if (!fGotBlockFromCache) {
-                        CBlock block;
-                        bool ret = ReadBlockFromDisk(block, pBestIndex, consensusParams);
-                        assert(ret);
-                        CBlockHeaderAndShortTxIDs cmpctblock(block, state.fWantsCmpctWitness);
-                        m_connman.PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
+                        SharedNetMsgPayloadRef payload = GetBlockPayload(m_block_cache, pBestIndex->GetBlockHash(), NetMsgType::CMPCTBLOCK, nSendFlags | blockMsgMaker.GetVersion(), [&] {
+                            CBlock block;
+                            bool ret = ReadBlockFromDisk(block, pBestIndex, consensusParams);
+                            assert(ret);
+                            return blockMsgMaker.MakePayload(nSendFlags, CBlockHeaderAndShortTxIDs(block, state.fWantsCmpctWitness));
+                        });
+                        m_connman.PushMessage(pto, CNetMsgMaker::MakeShared(NetMsgType::CMPCTBLOCK, std::move(payload)));
                     }
                     state.pindexBestHeaderSent = pBestIndex;
                 } else if (state.fPreferHeaders) {
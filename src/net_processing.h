@@ -18,6 +18,7 @@ class CBlockHeader;
 class CChainParams;
 class CTxMemPool;
 class ChainstateManager;
+class SerializedBlockCache;
 class TxValidationState;
 
 extern RecursiveMutex cs_main;
@@ -35,7 +36,8 @@ static const int DISCOURAGEMENT_THRESHOLD{100};
 class PeerManager final : public CValidationInterface, public NetEventsInterface {
 public:
     PeerManager(const CChainParams& chainparams, CConnman& connman, BanMan* banman,
-                CScheduler& scheduler, ChainstateManager& chainman, CTxMemPool& pool);
+                CScheduler& scheduler, ChainstateManager& chainman, CTxMemPool& pool,
+                SerializedBlockCache* block_cache = nullptr);
 
     /**
      * Overridden from CValidationInterface.
@@ -140,6 +142,8 @@ private:
     BanMan* const m_banman;
     ChainstateManager& m_chainman;
     CTxMemPool& m_mempool;
+    /** Serialized forms of recently served blocks, may be null */
+    SerializedBlockCache* const m_block_cache;
     TxRequestTracker m_txrequest GUARDED_BY(::cs_main);
 
     int64_t m_stale_tip_check_time; //!< Next time to check for stale tip
@@ -29,6 +29,25 @@ public:
         return Make(0, std::move(msg_type), std::forward<Args>(args)...);
     }
 
+    /** Serialize a payload once, to be sent to several peers with MakeShared() */
+    template <typename... Args>
+    SharedNetMsgPayloadRef MakePayload(int nFlags, Args&&... args) const
+    {
+        std::vector<unsigned char> data;
+        CVectorWriter{ SER_NETWORK, nFlags | nVersion, data, 0, std::forward<Args>(args)... };
+        return std::make_shared<const CSharedNetMsgPayload>(std::move(data));
+    }
+
+    static CSerializedNetMsg MakeShared(std::string msg_type, SharedNetMsgPayloadRef payload)
+    {
+        CSerializedNetMsg msg;
+        msg.m_type = std::move(msg_type);
+        msg.m_shared_payload = std::move(payload);
+        return msg;
+    }
+
+    int GetVersion() const { return nVersion; }
+
 private:
     const int nVersion;
 };
@@ -0,0 +1,245 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockimport.h>
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <flatfile.h>
+#include <logging.h>
+#include <shutdown.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/threadnames.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+//! Serialized size of the blocks buffered by all readers together
+static constexpr size_t IMPORT_BUFFER_BYTES = 128 << 20;
+
+static Mutex g_import_stats_mutex;
+static BlockImportStats g_import_stats GUARDED_BY(g_import_stats_mutex);
+static int64_t g_import_start_time GUARDED_BY(g_import_stats_mutex){0};
+
+namespace {
+
+class BlockImporter
+{
+public:
+    BlockImporter(const CChainParams& chainparams, const std::vector<BlockImportFile>& files, int num_threads)
+        : m_chainparams(chainparams), m_files(files), m_num_readers(num_threads),
+          m_max_buffered(std::max<size_t>(MAX_BLOCK_SERIALIZED_SIZE_WITH_MWEB, IMPORT_BUFFER_BYTES / num_threads)),
+          m_queues(files.size())
+    {
+        for (int i = 0; i < num_threads; ++i) {
+            m_readers.emplace_back(&BlockImporter::ReaderThread, this, i);
+        }
+    }
+
+    ~BlockImporter()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_reader_cv.notify_all();
+        for (std::thread& reader : m_readers) {
+            reader.join();
+        }
+    }
+
+    bool Run();
+
+private:
+    //! Blocks read from one file, waiting to be processed
+    struct FileQueue {
+        std::deque<ImportedBlock> blocks;
+        size_t bytes{0};
+        bool done{false};
+        bool open_failed{false};
+    };
+
+    void ReaderThread(int id);
+    void ReadFile(size_t index);
+
+    const CChainParams& m_chainparams;
+    const std::vector<BlockImportFile>& m_files;
+    const size_t m_num_readers;
+    //! Serialized size of the blocks each reader may buffer
+    const size_t m_max_buffered;
+
+    Mutex m_mutex;
+    //! Readers wait on this for a file to read, or room in its queue
+    std::condition_variable m_reader_cv;
+    //! Run() waits on this for blocks from the file it processes
+    std::condition_variable m_blocks_cv;
+    std::vector<FileQueue> m_queues GUARDED_BY(m_mutex);
+    //! Next file to hand to a reader
+    size_t m_next_file GUARDED_BY(m_mutex){0};
+    //! File being processed by Run()
+    size_t m_current_file GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_readers;
+};
+
+void BlockImporter::ReaderThread(int id)
+{
+    util::ThreadRename(strprintf("loadblk.%i", id));
+    while (true) {
+        size_t index;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            // Read at most one file ahead per reader
+            m_reader_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                return m_stop || m_next_file >= m_files.size() || m_next_file < m_current_file + m_num_readers;
+            });
+            if (m_stop || m_next_file >= m_files.size()) return;
+            index = m_next_file++;
+        }
+        ReadFile(index);
+    }
+}
+
+void BlockImporter::ReadFile(size_t index)
+{
+    const BlockImportFile& file = m_files[index];
+    Optional<FlatFilePos> pos;
+    FILE* fileIn;
+    if (file.file_number) {
+        pos = FlatFilePos(*file.file_number, 0);
+        fileIn = OpenBlockFile(*pos, true);
+    } else {
+        fileIn = fsbridge::fopen(file.path, "rb");
+    }
+
+    if (fileIn) {
+        ScanBlockFile(m_chainparams, fileIn, pos ? &*pos : nullptr, [&](ImportedBlock&& imported) {
+            // Check the proof of work, merkle root and transactions ahead of
+            // time. This marks valid blocks as checked, so that AcceptBlock()
+            // does not check them again; it handles any failures.
+            BlockValidationState state;
+            CheckBlock(*imported.block, state, m_chainparams.GetConsensus());
+            {
+                LOCK(g_import_stats_mutex);
+                ++g_import_stats.blocks_read;
+                g_import_stats.bytes_read += imported.size;
+            }
+
+            WAIT_LOCK(m_mutex, lock);
+            FileQueue& queue = m_queues[index];
+            m_reader_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || queue.bytes < m_max_buffered; });
+            if (m_stop) return false;
+            queue.bytes += imported.size;
+            queue.blocks.push_back(std::move(imported));
+            if (index == m_current_file) m_blocks_cv.notify_one();
+            return true;
+        });
+    }
+
+    LOCK(m_mutex);
+    m_queues[index].open_failed = fileIn == nullptr;
+    m_queues[index].done = true;
+    m_blocks_cv.notify_one();
+}
+
+bool BlockImporter::Run()
+{
+    for (size_t index = 0; index < m_files.size(); ++index) {
+        const BlockImportFile& file = m_files[index];
+        if (file.file_number) {
+            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)*file.file_number);
+        } else {
+            LogPrintf("Importing blocks file %s...\n", file.path.string());
+        }
+
+        const int64_t nStart = GetTimeMillis();
+        int nLoaded = 0;
+        bool fatal_error = false;
+        bool open_failed = false;
+        while (true) {
+            ImportedBlock imported;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                FileQueue& queue = m_queues[index];
+                m_blocks_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return !queue.blocks.empty() || queue.done; });
+                if (queue.blocks.empty()) {
+                    open_failed = queue.open_failed;
+                    break;
+                }
+                imported = std::move(queue.blocks.front());
+                queue.blocks.pop_front();
+                queue.bytes -= imported.size;
+            }
+            m_reader_cv.notify_all();
+
+            if (ShutdownRequested()) return false;
+            // After a fatal error, skip the rest of the file like LoadExternalBlockFile() does
+            if (!fatal_error && !ProcessImportedBlock(m_chainparams, imported, nLoaded)) {
+                fatal_error = true;
+            }
+        }
+        if (ShutdownRequested()) return false;
+
+        if (open_failed) {
+            if (file.file_number) {
+                // This error is logged in OpenBlockFile
+                break;
+            }
+            LogPrintf("Warning: Could not open blocks file %s\n", file.path.string());
+        } else {
+            LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+        }
+
+        {
+            LOCK(g_import_stats_mutex);
+            ++g_import_stats.files_done;
+            g_import_stats.blocks_loaded += nLoaded;
+        }
+        {
+            LOCK(m_mutex);
+            m_current_file = index + 1;
+        }
+        m_reader_cv.notify_all();
+    }
+    return true;
+}
+
+} // namespace
+
+bool ImportBlockFiles(const CChainParams& chainparams, const std::vector<BlockImportFile>& files, int num_threads)
+{
+    {
+        LOCK(g_import_stats_mutex);
+        g_import_stats = BlockImportStats{};
+        g_import_stats.active = true;
+        g_import_stats.files = files.size();
+        g_import_start_time = GetTimeMillis();
+    }
+
+    bool ret;
+    {
+        BlockImporter importer(chainparams, files, std::max(1, num_threads));
+        ret = importer.Run();
+    }
+
+    LOCK(g_import_stats_mutex);
+    g_import_stats.active = false;
+    g_import_stats.elapsed_ms = GetTimeMillis() - g_import_start_time;
+    LogPrintf("Imported %u blocks (%.1f MiB) from %u files in %dms\n", g_import_stats.blocks_loaded,
+              g_import_stats.bytes_read * (1.0 / 1024 / 1024), g_import_stats.files_done, g_import_stats.elapsed_ms);
+    return ret;
+}
+
+BlockImportStats GetBlockImportStats()
+{
+    LOCK(g_import_stats_mutex);
+    BlockImportStats stats = g_import_stats;
+    if (stats.active) stats.elapsed_ms = GetTimeMillis() - g_import_start_time;
+    return stats;
+}
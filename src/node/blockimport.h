@@ -0,0 +1,64 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKIMPORT_H
+#define BITCOIN_NODE_BLOCKIMPORT_H
+
+#include <fs.h>
+#include <optional.h>
+
+#include <stdint.h>
+#include <vector>
+
+class CChainParams;
+
+/** Default number of -importthreads */
+static const int DEFAULT_IMPORT_THREADS = 4;
+/** Maximum number of -importthreads */
+static const int MAX_IMPORT_THREADS = 16;
+
+struct BlockImportStats
+{
+    //! Whether an import is running
+    bool active{false};
+    //! Block files to import, and those fully processed
+    uint64_t files{0};
+    uint64_t files_done{0};
+    //! Blocks read from the files, and their serialized size
+    uint64_t blocks_read{0};
+    uint64_t bytes_read{0};
+    //! Blocks added to the block index
+    uint64_t blocks_loaded{0};
+    //! Time spent importing, in milliseconds
+    int64_t elapsed_ms{0};
+};
+
+/** A block file to import, see ImportBlockFiles() */
+struct BlockImportFile
+{
+    fs::path path;
+    //! Number of the file if it is one of our own block files (-reindex)
+    Optional<int> file_number;
+};
+
+/**
+ * Import the blocks in `files`, as LoadExternalBlockFile() would one file
+ * after the other.
+ *
+ * Up to `num_threads` files are read ahead at a time, each by its own thread,
+ * which deserializes the blocks and runs the context-free block checks
+ * (proof of work, merkle root, transactions) on them. The calling thread then
+ * adds the blocks to the block index in file order, so that out of order
+ * blocks are resolved as before. Each reader buffers a bounded number of
+ * blocks.
+ *
+ * If one of our own block files cannot be opened, the files after it are
+ * skipped, like -reindex does. Returns false if interrupted by a shutdown.
+ */
+bool ImportBlockFiles(const CChainParams& chainparams, const std::vector<BlockImportFile>& files, int num_threads);
+
+/** Progress of the running or last block import */
+BlockImportStats GetBlockImportStats();
+
+#endif // BITCOIN_NODE_BLOCKIMPORT_H
@@ -8,6 +8,7 @@
 #include <interfaces/chain.h>
 #include <net.h>
 #include <net_processing.h>
+#include <node/serializedblockcache.h>
 #include <scheduler.h>
 #include <txmempool.h>
 
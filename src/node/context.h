@@ -17,6 +17,7 @@ class CScheduler;
 class CTxMemPool;
 class ChainstateManager;
 class PeerManager;
+class SerializedBlockCache;
 namespace interfaces {
 class Chain;
 class ChainClient;
@@ -36,6 +37,7 @@ class WalletClient;
 struct NodeContext {
     std::unique_ptr<CConnman> connman;
     std::unique_ptr<CTxMemPool> mempool;
+    std::unique_ptr<SerializedBlockCache> block_cache;
     std::unique_ptr<PeerManager> peerman;
     ChainstateManager* chainman{nullptr}; // Currently a raw pointer because the memory is not managed by this struct
     std::unique_ptr<BanMan> banman;
@@ -0,0 +1,238 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/inputprefetcher.h>
+
+#include <logging.h>
+#include <tinyformat.h>
+#include <txdb.h>
+#include <util/threadnames.h>
+#include <validation.h>
+
+#include <mw/node/CoinsView.h>
+
+#include <algorithm>
+#include <set>
+
+//! Number of lookups a worker claims at a time
+static constexpr size_t LOOKUP_CHUNK = 16;
+
+struct InputPrefetcher::Job
+{
+    enum class Stage {
+        LOAD,    //!< Waiting for a worker to read the block and collect its inputs
+        LOADING,
+        LOOKUP,  //!< Inputs are being looked up by all workers
+        DONE,
+    };
+
+    uint256 block_hash;
+    FlatFilePos pos;
+    std::shared_ptr<const CBlock> block;
+    const CCoinsViewDB* db;
+    const Consensus::Params* params;
+    //! CCoinsViewDB::GetWriteCount() when the job was started
+    uint64_t write_count;
+
+    //! Guarded by InputPrefetcher::m_mutex
+    Stage stage{Stage::LOAD};
+    std::atomic<bool> cancelled{false};
+
+    //! Set up by LoadBlock() before the LOOKUP stage, and not resized after
+    std::vector<COutPoint> outpoints;
+    std::vector<Coin> coins;
+    std::vector<char> found;
+    std::vector<mw::Hash> mweb_ids;
+    mw::ICoinsView::Ptr mweb_view;
+    size_t total{0};
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+};
+
+InputPrefetcher::InputPrefetcher(int num_threads)
+{
+    for (int i = 0; i < num_threads; ++i) {
+        m_workers.emplace_back(&InputPrefetcher::WorkerThread, this, i);
+    }
+}
+
+InputPrefetcher::~InputPrefetcher()
+{
+    Cancel();
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+    }
+    m_work_cv.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void InputPrefetcher::WorkerThread(int id)
+{
+    util::ThreadRename(strprintf("prefetch.%i", id));
+    while (true) {
+        std::shared_ptr<Job> job;
+        bool load{false};
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_work_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                return m_stop || (m_job && (m_job->stage == Job::Stage::LOAD ||
+                                            (m_job->stage == Job::Stage::LOOKUP && m_job->next < m_job->total)));
+            });
+            if (m_stop) return;
+            job = m_job;
+            if (job->stage == Job::Stage::LOAD) {
+                job->stage = Job::Stage::LOADING;
+                load = true;
+            }
+        }
+        if (load) LoadBlock(*job);
+        Lookup(*job);
+    }
+}
+
+void InputPrefetcher::LoadBlock(Job& job)
+{
+    if (!job.cancelled && !job.block) {
+        std::shared_ptr<CBlock> block = std::make_shared<CBlock>();
+        if (ReadBlockFromDisk(*block, job.pos, job.block_hash, *job.params)) {
+            job.block = std::move(block);
+        } else {
+            LogPrint(BCLog::BENCH, "Unable to prefetch inputs of block %s\n", job.block_hash.ToString());
+        }
+    }
+
+    if (!job.cancelled && job.block) {
+        // Outputs created in the block itself cannot be on disk yet
+        std::set<uint256> txids;
+        for (const CTransactionRef& tx : job.block->vtx) {
+            txids.insert(tx->GetHash());
+        }
+        for (const CTransactionRef& tx : job.block->vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const CTxIn& txin : tx->vin) {
+                if (txids.count(txin.prevout.hash)) continue;
+                job.outpoints.push_back(txin.prevout);
+            }
+        }
+        job.coins.resize(job.outpoints.size());
+        job.found.resize(job.outpoints.size(), false);
+        if (job.mweb_view) {
+            job.mweb_ids = job.block->mweb_block.GetSpentIDs();
+        }
+        job.total = job.outpoints.size() + job.mweb_ids.size();
+    }
+
+    LOCK(m_mutex);
+    job.stage = job.total > 0 ? Job::Stage::LOOKUP : Job::Stage::DONE;
+    m_work_cv.notify_all();
+    m_done_cv.notify_all();
+}
+
+void InputPrefetcher::Lookup(Job& job)
+{
+    for (size_t first = job.next.fetch_add(LOOKUP_CHUNK); first < job.total; first = job.next.fetch_add(LOOKUP_CHUNK)) {
+        const size_t last = std::min(first + LOOKUP_CHUNK, job.total);
+        for (size_t i = first; i < last && !job.cancelled; ++i) {
+            try {
+                if (i < job.outpoints.size()) {
+                    job.found[i] = job.db->GetCoin(job.outpoints[i], job.coins[i]);
+                } else {
+                    job.mweb_view->GetUTXO(job.mweb_ids[i - job.outpoints.size()]);
+                }
+            } catch (const std::exception& e) {
+                // Leave read errors to the lookups made while connecting the block
+                LogPrint(BCLog::BENCH, "Error prefetching inputs of block %s: %s\n", job.block_hash.ToString(), e.what());
+                job.cancelled = true;
+            }
+        }
+        if (job.done.fetch_add(last - first) + (last - first) == job.total) {
+            LOCK(m_mutex);
+            job.stage = Job::Stage::DONE;
+            m_done_cv.notify_all();
+        }
+    }
+}
+
+std::shared_ptr<InputPrefetcher::Job> InputPrefetcher::TakeJob(const uint256* keep)
+{
+    WAIT_LOCK(m_mutex, lock);
+    if (!m_job) return nullptr;
+    if (!keep || m_job->block_hash != *keep) {
+        m_job->cancelled = true;
+        // Nothing to wait for if no worker picked the job up yet
+        if (m_job->stage == Job::Stage::LOAD) m_job->stage = Job::Stage::DONE;
+    }
+    m_done_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_job->stage == Job::Stage::DONE; });
+    return std::move(m_job);
+}
+
+void InputPrefetcher::Start(const uint256& block_hash, const FlatFilePos& pos, std::shared_ptr<const CBlock> block,
+                            const CCoinsViewDB& db, const Consensus::Params& params)
+{
+    Cancel();
+
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->block_hash = block_hash;
+    job->pos = pos;
+    job->block = std::move(block);
+    job->db = &db;
+    job->params = &params;
+    job->write_count = db.GetWriteCount();
+    job->mweb_view = db.GetMWEBView();
+    {
+        LOCK(m_mutex);
+        m_job = std::move(job);
+    }
+    m_work_cv.notify_all();
+}
+
+std::shared_ptr<const CBlock> InputPrefetcher::Finish(const uint256& block_hash, CCoinsViewCache& cache)
+{
+    std::shared_ptr<Job> job = TakeJob(&block_hash);
+    if (!job || job->block_hash != block_hash) return nullptr;
+    if (job->cancelled) return job->block;
+
+    InputPrefetchStats stats;
+    stats.blocks = 1;
+    stats.inputs = job->outpoints.size();
+    stats.mweb_inputs = job->mweb_ids.size();
+    if (job->db->GetWriteCount() != job->write_count) {
+        stats.discarded = job->outpoints.size();
+    } else {
+        for (size_t i = 0; i < job->outpoints.size(); ++i) {
+            if (!job->found[i]) {
+                ++stats.missing;
+            } else if (cache.WarmCoin(job->outpoints[i], std::move(job->coins[i]))) {
+                ++stats.warmed;
+            } else {
+                ++stats.cached;
+            }
+        }
+    }
+
+    LOCK(m_mutex);
+    m_stats.blocks += stats.blocks;
+    m_stats.inputs += stats.inputs;
+    m_stats.warmed += stats.warmed;
+    m_stats.cached += stats.cached;
+    m_stats.missing += stats.missing;
+    m_stats.discarded += stats.discarded;
+    m_stats.mweb_inputs += stats.mweb_inputs;
+    return job->block;
+}
+
+void InputPrefetcher::Cancel()
+{
+    TakeJob(nullptr);
+}
+
+InputPrefetchStats InputPrefetcher::GetStats() const
+{
+    LOCK(m_mutex);
+    return m_stats;
+}
@@ -0,0 +1,117 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_INPUTPREFETCHER_H
+#define BITCOIN_NODE_INPUTPREFETCHER_H
+
+#include <coins.h>
+#include <flatfile.h>
+#include <primitives/block.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class CCoinsViewDB;
+namespace Consensus {
+struct Params;
+}
+
+/** Default number of -prefetchinputs threads */
+static const int DEFAULT_PREFETCH_INPUT_THREADS = 4;
+/** Maximum number of -prefetchinputs threads */
+static const int MAX_PREFETCH_INPUT_THREADS = 16;
+
+struct InputPrefetchStats
+{
+    //! Blocks connected with a finished prefetch
+    uint64_t blocks{0};
+    //! Inputs of those blocks, not counting spends of outputs created in the same block
+    uint64_t inputs{0};
+    //! Coins read from disk and added to the coins cache
+    uint64_t warmed{0};
+    //! Coins read from disk, but already in the coins cache
+    uint64_t cached{0};
+    //! Coins not on disk, because they were created after the last flush
+    uint64_t missing{0};
+    //! Lookups thrown away because the coins database was written meanwhile
+    uint64_t discarded{0};
+    //! MWEB inputs whose UTXOs were read from disk ahead of time
+    uint64_t mweb_inputs{0};
+};
+
+/**
+ * Looks up the inputs of the next block to be connected on a pool of
+ * worker threads, while the current block is being connected.
+ *
+ * Start() hands the workers the next block (reading it from disk if it is
+ * not given), whose transparent inputs are then read from the coins
+ * database in parallel. Before that block is connected, Finish() waits for
+ * the lookups and adds the coins found to the coins cache, so that
+ * ConnectBlock() does not have to read them one at a time.
+ *
+ * Coins read from disk are only added to the cache if the database was not
+ * written in the meantime and the cache has no entry for them: the cache
+ * holds everything that changed since the last flush, so any other coin
+ * read from disk is still current. MWEB UTXOs are only read, which warms
+ * the database cache, as the MWEB coins cache has no way to hold clean
+ * entries.
+ *
+ * Start() and Finish() are called with cs_main held, from the thread
+ * connecting blocks.
+ */
+class InputPrefetcher
+{
+public:
+    explicit InputPrefetcher(int num_threads);
+    ~InputPrefetcher();
+
+    InputPrefetcher(const InputPrefetcher&) = delete;
+    InputPrefetcher& operator=(const InputPrefetcher&) = delete;
+
+    /**
+     * Start looking up the inputs of the block `block_hash`, cancelling any
+     * earlier prefetch. `block` may be null, in which case the block is read
+     * from `pos`. `db` must stay valid until Finish() or Cancel() returns.
+     */
+    void Start(const uint256& block_hash, const FlatFilePos& pos, std::shared_ptr<const CBlock> block,
+               const CCoinsViewDB& db, const Consensus::Params& params);
+
+    /**
+     * Wait for the prefetch of `block_hash`, and add the coins found to
+     * `cache`, which must be the cache directly on top of the `db` given to
+     * Start(). Returns the block if the prefetch read it, or null if there
+     * was no prefetch of this block. A prefetch of another block is cancelled.
+     */
+    std::shared_ptr<const CBlock> Finish(const uint256& block_hash, CCoinsViewCache& cache);
+
+    //! Cancel the pending prefetch, if any, and wait for the workers to let go of it.
+    void Cancel();
+
+    int NumThreads() const { return m_workers.size(); }
+    InputPrefetchStats GetStats() const;
+
+private:
+    struct Job;
+
+    void WorkerThread(int id);
+    void LoadBlock(Job& job);
+    void Lookup(Job& job);
+    //! Wait for the current job, if any, to finish and take it. Cancels it unless it is for `keep`.
+    std::shared_ptr<Job> TakeJob(const uint256* keep);
+
+    mutable Mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    std::shared_ptr<Job> m_job GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    InputPrefetchStats m_stats GUARDED_BY(m_mutex);
+    std::vector<std::thread> m_workers;
+};
+
+#endif // BITCOIN_NODE_INPUTPREFETCHER_H
@@ -0,0 +1,125 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/serializedblockcache.h>
+
+#include <protocol.h>
+#include <streams.h>
+#include <util/threadnames.h>
+
+//! Blocks waiting to be serialized by FillAsync(); older ones are dropped
+static constexpr size_t MAX_FILL_QUEUE = 4;
+
+SerializedBlockCache::SerializedBlockCache(size_t max_bytes)
+    : m_max_bytes(max_bytes)
+{
+    // A disabled cache keeps nothing, so there is nothing to fill
+    if (m_max_bytes > 0) {
+        m_fill_thread = std::thread(&SerializedBlockCache::ThreadFill, this);
+    }
+}
+
+SerializedBlockCache::~SerializedBlockCache()
+{
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+    }
+    m_fill_cv.notify_all();
+    if (m_fill_thread.joinable()) m_fill_thread.join();
+}
+
+SharedNetMsgPayloadRef SerializedBlockCache::Get(const uint256& block_hash, const std::string& msg_type, int ser_version)
+{
+    LOCK(m_mutex);
+    auto it = m_index.find(Key{block_hash, msg_type, ser_version});
+    if (it == m_index.end()) {
+        ++m_misses;
+        return nullptr;
+    }
+    ++m_hits;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->payload;
+}
+
+SharedNetMsgPayloadRef SerializedBlockCache::GetOrMake(const uint256& block_hash, const std::string& msg_type, int ser_version,
+                                                       const std::function<SharedNetMsgPayloadRef()>& make_payload)
+{
+    SharedNetMsgPayloadRef payload = Get(block_hash, msg_type, ser_version);
+    if (payload) return payload;
+
+    payload = make_payload();
+    Add(block_hash, msg_type, ser_version, payload);
+    return payload;
+}
+
+void SerializedBlockCache::Add(const uint256& block_hash, const std::string& msg_type, int ser_version, SharedNetMsgPayloadRef payload)
+{
+    LOCK(m_mutex);
+    AddLocked(Key{block_hash, msg_type, ser_version}, std::move(payload));
+}
+
+void SerializedBlockCache::AddLocked(const Key& key, SharedNetMsgPayloadRef payload)
+{
+    const size_t size = payload->Data().size();
+    if (size > m_max_bytes || m_index.count(key)) return;
+
+    m_entries.push_front(Entry{key, std::move(payload)});
+    m_index.emplace(key, m_entries.begin());
+    m_bytes += size;
+    while (m_bytes > m_max_bytes) {
+        const Entry& oldest = m_entries.back();
+        m_bytes -= oldest.payload->Data().size();
+        m_index.erase(oldest.key);
+        m_entries.pop_back();
+    }
+}
+
+void SerializedBlockCache::FillAsync(std::shared_ptr<const CBlock> block, std::vector<int> ser_versions)
+{
+    if (m_max_bytes == 0) return;
+    {
+        LOCK(m_mutex);
+        m_fill_queue.push_back(FillJob{std::move(block), std::move(ser_versions)});
+        if (m_fill_queue.size() > MAX_FILL_QUEUE) m_fill_queue.pop_front();
+    }
+    m_fill_cv.notify_one();
+}
+
+void SerializedBlockCache::ThreadFill()
+{
+    util::ThreadRename("blockcache");
+    while (true) {
+        FillJob job;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_fill_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_fill_queue.empty(); });
+            if (m_stop) return;
+            job = std::move(m_fill_queue.front());
+            m_fill_queue.pop_front();
+        }
+
+        const uint256 hash = job.block->GetHash();
+        for (const int ser_version : job.ser_versions) {
+            if (WITH_LOCK(m_mutex, return m_index.count(Key{hash, NetMsgType::BLOCK, ser_version}) > 0)) continue;
+
+            std::vector<unsigned char> data;
+            CVectorWriter{SER_NETWORK, ser_version, data, 0, *job.block};
+            SharedNetMsgPayloadRef payload = std::make_shared<const CSharedNetMsgPayload>(std::move(data));
+            LOCK(m_mutex);
+            AddLocked(Key{hash, NetMsgType::BLOCK, ser_version}, std::move(payload));
+        }
+    }
+}
+
+SerializedBlockCacheStats SerializedBlockCache::GetStats() const
+{
+    LOCK(m_mutex);
+    SerializedBlockCacheStats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.entries = m_entries.size();
+    stats.bytes = m_bytes;
+    return stats;
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_SERIALIZEDBLOCKCACHE_H
+#define BITCOIN_NODE_SERIALIZEDBLOCKCACHE_H
+
+#include <net.h>
+#include <primitives/block.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+/** Default for -servedblockcache, in MiB */
+static const int64_t DEFAULT_SERVED_BLOCK_CACHE_MB = 32;
+
+struct SerializedBlockCacheStats
+{
+    uint64_t hits{0};
+    uint64_t misses{0};
+    size_t entries{0};
+    size_t bytes{0};
+};
+
+/**
+ * Memory-bounded cache of the serialized forms of recent blocks, and of
+ * messages derived from them such as cmpctblock, keyed by block hash, message
+ * type and serialization version (including flags like
+ * SERIALIZE_TRANSACTION_NO_WITNESS and SERIALIZE_NO_MWEB).
+ *
+ * Blocks that are requested by many peers, or over REST, are then read from
+ * disk and serialized once per variant, and the payloads are shared between
+ * the send queues of all peers. Entries are evicted least recently used
+ * first once their total size exceeds the limit.
+ *
+ * New blocks can be serialized ahead of the first request with FillAsync(),
+ * on a background thread that only runs while the cache is enabled
+ * (max_bytes > 0).
+ */
+class SerializedBlockCache
+{
+public:
+    explicit SerializedBlockCache(size_t max_bytes);
+    ~SerializedBlockCache();
+
+    SerializedBlockCache(const SerializedBlockCache&) = delete;
+    SerializedBlockCache& operator=(const SerializedBlockCache&) = delete;
+
+    //! The cached payload of (block_hash, msg_type, ser_version), or null
+    SharedNetMsgPayloadRef Get(const uint256& block_hash, const std::string& msg_type, int ser_version);
+
+    /**
+     * The cached payload of (block_hash, msg_type, ser_version), calling
+     * make_payload and adding the result if there is none. make_payload is
+     * called without holding the cache lock.
+     */
+    SharedNetMsgPayloadRef GetOrMake(const uint256& block_hash, const std::string& msg_type, int ser_version,
+                                     const std::function<SharedNetMsgPayloadRef()>& make_payload);
+
+    void Add(const uint256& block_hash, const std::string& msg_type, int ser_version, SharedNetMsgPayloadRef payload);
+
+    //! Serialize block with each of ser_versions as a block message in the background
+    void FillAsync(std::shared_ptr<const CBlock> block, std::vector<int> ser_versions);
+
+    SerializedBlockCacheStats GetStats() const;
+
+private:
+    using Key = std::tuple<uint256, std::string, int>;
+    struct Entry {
+        Key key;
+        SharedNetMsgPayloadRef payload;
+    };
+    struct FillJob {
+        std::shared_ptr<const CBlock> block;
+        std::vector<int> ser_versions;
+    };
+
+    void AddLocked(const Key& key, SharedNetMsgPayloadRef payload) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void ThreadFill();
+
+    const size_t m_max_bytes;
+
+    mutable Mutex m_mutex;
+    //! Most recently used first
+    std::list<Entry> m_entries GUARDED_BY(m_mutex);
+    std::map<Key, std::list<Entry>::iterator> m_index GUARDED_BY(m_mutex);
+    size_t m_bytes GUARDED_BY(m_mutex){0};
+    uint64_t m_hits GUARDED_BY(m_mutex){0};
+    uint64_t m_misses GUARDED_BY(m_mutex){0};
+
+    std::condition_variable m_fill_cv;
+    std::deque<FillJob> m_fill_queue GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::thread m_fill_thread;
+};
+
+#endif // BITCOIN_NODE_SERIALIZEDBLOCKCACHE_H
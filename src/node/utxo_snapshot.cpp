@@ -0,0 +1,314 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/utxo_snapshot.h>
+
+#include <chain.h>
+#include <consensus/params.h>
+#include <primitives/block.h>
+#include <streams.h>
+#include <tinyformat.h>
+#include <validation.h>
+
+#include <mw/consensus/KernelSumValidator.h>
+#include <mw/mmr/LeafSet.h>
+#include <mw/mmr/MMR.h>
+#include <mw/mmr/Segment.h>
+#include <mw/node/CoinsView.h>
+
+uint64_t WriteMWEBSnapshotState(CAutoFile& file, const CBlock& base_block, const mw::ICoinsView& view, const std::function<void()>& interruption_point)
+{
+    SnapshotMWEBState state;
+    state.m_active = !base_block.mweb_block.IsNull();
+    if (!state.m_active) {
+        file << state;
+        return 0;
+    }
+
+    state.m_proof = CMerkleBlockWithMWEB(base_block);
+
+    ILeafSet::Ptr leafset = view.GetLeafSet();
+    IMMR::Ptr pmmr = view.GetOutputPMMR();
+    const uint64_t num_bytes = (leafset->GetNextLeafIdx().Get() + 7) / 8;
+    state.m_leafset.reserve(num_bytes);
+    for (uint64_t byte_idx = 0; byte_idx < num_bytes; byte_idx++) {
+        state.m_leafset.push_back(leafset->GetByte(byte_idx));
+    }
+    for (mmr::LeafIndex leaf_idx = mmr::LeafIndex::At(0); leaf_idx < leafset->GetNextLeafIdx(); ++leaf_idx) {
+        if (leafset->Contains(leaf_idx)) ++state.m_utxo_count;
+    }
+    file << state;
+
+    uint64_t written{0};
+    mmr::LeafIndex first_leaf_idx = mmr::LeafIndex::At(0);
+    while (written < state.m_utxo_count) {
+        interruption_point();
+        while (!leafset->Contains(first_leaf_idx)) ++first_leaf_idx;
+
+        mmr::Segment segment = mmr::SegmentFactory::Assemble(*pmmr, *leafset, first_leaf_idx, MWEB_SNAPSHOT_SEGMENT_SIZE);
+        SnapshotMWEBSegment out;
+        out.m_first_leaf_idx = first_leaf_idx.Get();
+        out.m_utxos.reserve(segment.leaves.size());
+        for (const mmr::Leaf& leaf : segment.leaves) {
+            UTXO::CPtr utxo = view.GetUTXO(leaf.vec());
+            if (!utxo) {
+                throw std::runtime_error(strprintf("MWEB UTXO %s at leaf %d not found", HexStr(leaf.vec()), leaf.GetLeafIndex().Get()));
+            }
+            out.m_utxos.push_back(*utxo);
+        }
+        out.m_hashes = std::move(segment.hashes);
+        out.m_has_lower_peak = !!segment.lower_peak;
+        if (segment.lower_peak) out.m_lower_peak = *segment.lower_peak;
+        file << out;
+
+        written += out.m_utxos.size();
+        first_leaf_idx = segment.leaves.back().GetLeafIndex();
+        ++first_leaf_idx;
+    }
+
+    return written;
+}
+
+uint64_t WriteMWEBSnapshotKernels(CAutoFile& file, const CBlockIndex* base, const Consensus::Params& params, const std::function<void()>& interruption_point)
+{
+    std::vector<const CBlockIndex*> mweb_blocks;
+    for (const CBlockIndex* pindex = base; pindex && IsMWEBEnabled(pindex->pprev, params); pindex = pindex->pprev) {
+        mweb_blocks.push_back(pindex);
+    }
+
+    uint64_t written{0};
+    file << uint64_t(mweb_blocks.size());
+    for (auto it = mweb_blocks.rbegin(); it != mweb_blocks.rend(); ++it) {
+        interruption_point();
+        CBlock block;
+        if (!ReadBlockFromDisk(block, *it, params)) {
+            throw std::runtime_error(strprintf("Unable to read block %s", (*it)->GetBlockHash().ToString()));
+        }
+        if (block.mweb_block.IsNull()) {
+            throw std::runtime_error(strprintf("Block %s has no MWEB data", (*it)->GetBlockHash().ToString()));
+        }
+        const std::vector<Kernel>& kernels = block.mweb_block.m_block->GetKernels();
+        file << kernels;
+        written += kernels.size();
+    }
+
+    return written;
+}
+
+bool SnapshotMWEBValidator::ReadState(CAutoFile& file, std::string& error, const std::function<void()>& interruption_point)
+{
+    file >> m_state;
+
+    if (m_state.m_active != IsMWEBEnabled(m_base.pprev, m_params)) {
+        error = m_state.m_active ? "snapshot has MWEB state, but MWEB is not active at the base block" : "snapshot is missing the MWEB state";
+        return false;
+    }
+    if (!m_state.m_active) return true;
+
+    // The MWEB header must be committed to by the HogEx, which must be the last transaction of the base block
+    const CTransactionRef& hogex = m_state.m_proof.GetHogEx();
+    const mw::Header::CPtr& header = m_state.m_proof.GetMWEBHeader();
+    CMerkleBlock merkle = m_state.m_proof.GetMerkleBlock();
+    std::vector<uint256> matches;
+    std::vector<unsigned int> match_indices;
+    if (!hogex || !header || merkle.header.GetHash() != m_base.GetBlockHash() ||
+        merkle.txn.ExtractMatches(matches, match_indices) != merkle.header.hashMerkleRoot ||
+        matches.size() != 1 || matches[0] != hogex->GetHash() ||
+        match_indices[0] + 1 != merkle.txn.GetNumTransactions()) {
+        error = "invalid HogEx proof for the base block";
+        return false;
+    }
+
+    mw::Hash committed_header_hash;
+    if (!hogex->IsHogEx() || hogex->vout.empty() || !hogex->vout.front().scriptPubKey.IsMWEBHogAddr(&committed_header_hash) ||
+        committed_header_hash != header->GetHash()) {
+        error = "MWEB header is not committed to by the base block";
+        return false;
+    }
+
+    // The leafset must match the header's leafset root and number of outputs
+    const mmr::LeafIndex next_leaf_idx = mmr::LeafIndex::At(header->GetNumTXOs());
+    if (m_state.m_leafset.size() != (next_leaf_idx.Get() + 7) / 8) {
+        error = "MWEB leafset size does not match the MWEB header";
+        return false;
+    }
+    MemLeafSet leafset(next_leaf_idx, m_state.m_leafset);
+    if (leafset.Root() != header->GetLeafsetRoot()) {
+        error = "MWEB leafset does not match the MWEB header";
+        return false;
+    }
+
+    uint64_t num_unspent{0};
+    for (mmr::LeafIndex leaf_idx = mmr::LeafIndex::At(0); leaf_idx < next_leaf_idx; ++leaf_idx) {
+        if (leafset.Contains(leaf_idx)) ++num_unspent;
+    }
+    if (num_unspent != m_state.m_utxo_count) {
+        error = "MWEB UTXO count does not match the leafset";
+        return false;
+    }
+
+    // Each segment must start at the next unspent leaf, and recompute the output
+    // root. Only the sum of the UTXO commitments is kept for ReadKernels().
+    m_utxo_sum = Commitment{};
+    uint64_t num_read{0};
+    mmr::LeafIndex first_leaf_idx = mmr::LeafIndex::At(0);
+    while (num_read < m_state.m_utxo_count) {
+        interruption_point();
+        SnapshotMWEBSegment in;
+        file >> in;
+
+        while (first_leaf_idx < next_leaf_idx && !leafset.Contains(first_leaf_idx)) ++first_leaf_idx;
+        if (in.m_first_leaf_idx != first_leaf_idx.Get() || in.m_utxos.empty() ||
+            in.m_utxos.size() > MWEB_SNAPSHOT_SEGMENT_SIZE ||
+            in.m_utxos.size() > m_state.m_utxo_count - num_read) {
+            error = strprintf("unexpected MWEB UTXO segment at leaf %d", in.m_first_leaf_idx);
+            return false;
+        }
+
+        mmr::Segment segment;
+        segment.leaves.reserve(in.m_utxos.size());
+        std::vector<Commitment> commitments{m_utxo_sum};
+        commitments.reserve(in.m_utxos.size() + 1);
+        for (const UTXO& utxo : in.m_utxos) {
+            segment.leaves.push_back(mmr::Leaf::Create(utxo.GetLeafIndex(), utxo.GetOutputID().vec()));
+            commitments.push_back(utxo.GetCommitment());
+        }
+        m_utxo_sum = Pedersen::AddCommitments(commitments);
+        num_read += in.m_utxos.size();
+        segment.hashes = std::move(in.m_hashes);
+        if (in.m_has_lower_peak) segment.lower_peak = in.m_lower_peak;
+
+        if (mmr::SegmentFactory::CalcRoot(segment, leafset, first_leaf_idx) != header->GetOutputRoot()) {
+            error = strprintf("MWEB UTXO segment at leaf %d does not match the output root", in.m_first_leaf_idx);
+            return false;
+        }
+
+        first_leaf_idx = segment.leaves.back().GetLeafIndex();
+        ++first_leaf_idx;
+    }
+
+    return true;
+}
+
+bool SnapshotMWEBValidator::ReadKernels(CAutoFile& file, std::string& error, const std::function<void()>& interruption_point)
+{
+    uint64_t num_blocks;
+    file >> num_blocks;
+    if (!m_state.m_active) {
+        if (num_blocks != 0) {
+            error = "snapshot has MWEB kernels, but MWEB is not active at the base block";
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t expected_blocks{0};
+    for (const CBlockIndex* pindex = &m_base; pindex && IsMWEBEnabled(pindex->pprev, m_params); pindex = pindex->pprev) {
+        ++expected_blocks;
+    }
+    if (num_blocks != expected_blocks) {
+        error = strprintf("snapshot has kernels for %d MWEB blocks, expected %d", num_blocks, expected_blocks);
+        return false;
+    }
+
+    // The kernels are read a block at a time and only their sums are kept, so
+    // that memory use does not grow with the number of MWEB blocks
+    std::vector<Kernel> block_kernels;
+    Commitment excess_sum;
+    CAmount supply{0};
+    m_kernel_count = 0;
+    for (uint64_t i = 0; i < num_blocks; i++) {
+        interruption_point();
+        block_kernels.clear();
+        file >> block_kernels;
+        std::vector<Commitment> commitments = Commitments::From(block_kernels);
+        commitments.push_back(excess_sum);
+        excess_sum = Pedersen::AddCommitments(commitments);
+        for (const Kernel& kernel : block_kernels) {
+            supply += kernel.GetSupplyChange();
+            // Total supply can never go below 0
+            if (supply < 0) {
+                error = "MWEB kernels take more out of the MWEB than was put in";
+                return false;
+            }
+        }
+        m_kernel_count += block_kernels.size();
+    }
+
+    // The header only commits to the kernels of the base block itself
+    const mw::Header::CPtr& header = m_state.m_proof.GetMWEBHeader();
+    MemMMR base_kernel_mmr;
+    for (const Kernel& kernel : block_kernels) {
+        base_kernel_mmr.Add(kernel);
+    }
+    if (base_kernel_mmr.GetNumLeaves() != header->GetNumKernels() || base_kernel_mmr.Root() != header->GetKernelRoot()) {
+        error = "MWEB kernels of the base block do not match the MWEB header";
+        return false;
+    }
+
+    if (supply != m_state.m_proof.GetHogEx()->vout.front().nValue) {
+        error = "MWEB kernels do not match the HogEx amount";
+        return false;
+    }
+
+    try {
+        KernelSumValidator::ValidateStateSums(m_utxo_sum, excess_sum, supply, header->GetKernelOffset());
+    } catch (const std::exception& e) {
+        error = strprintf("MWEB UTXOs and kernels do not balance: %s", e.what());
+        return false;
+    }
+
+    return true;
+}
+
+namespace {
+class SnapshotCoinsCursor : public CCoinsViewCursor
+{
+public:
+    SnapshotCoinsCursor(CAutoFile& file, const SnapshotMetadata& metadata)
+        : CCoinsViewCursor(metadata.m_base_blockhash), m_file(file), m_remaining(metadata.m_coins_count)
+    {
+        Next();
+    }
+
+    bool GetKey(COutPoint& key) const override
+    {
+        key = m_key;
+        return true;
+    }
+    bool GetValue(Coin& coin) const override
+    {
+        coin = m_coin;
+        return true;
+    }
+    unsigned int GetValueSize() const override { return 0; }
+
+    bool Valid() const override { return m_valid; }
+    void Next() override
+    {
+        m_valid = false;
+        if (m_remaining == 0) return;
+        --m_remaining;
+        try {
+            m_file >> m_key >> m_coin;
+            m_valid = true;
+        } catch (const std::ios_base::failure&) {
+            // Leaves the cursor invalid; callers compare the number of coins read
+            m_remaining = 0;
+        }
+    }
+
+private:
+    CAutoFile& m_file;
+    uint64_t m_remaining;
+    bool m_valid{false};
+    COutPoint m_key;
+    Coin m_coin;
+};
+} // namespace
+
+CCoinsViewCursor* SnapshotCoinsView::Cursor() const
+{
+    return new SnapshotCoinsCursor(m_file, m_metadata);
+}
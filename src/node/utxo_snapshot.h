@@ -6,9 +6,29 @@
 #ifndef BITCOIN_NODE_UTXO_SNAPSHOT_H
 #define BITCOIN_NODE_UTXO_SNAPSHOT_H
 
+#include <coins.h>
+#include <merkleblock.h>
 #include <uint256.h>
 #include <serialize.h>
 
+#include <mw/models/crypto/Commitment.h>
+#include <mw/models/crypto/Hash.h>
+#include <mw/models/tx/UTXO.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class CAutoFile;
+class CBlock;
+class CBlockIndex;
+namespace Consensus {
+struct Params;
+}
+namespace mw {
+class ICoinsView;
+}
+
 //! Metadata describing a serialized version of a UTXO set from which an
 //! assumeutxo CChainState can be constructed.
 class SnapshotMetadata
@@ -38,4 +58,134 @@ public:
     SERIALIZE_METHODS(SnapshotMetadata, obj) { READWRITE(obj.m_base_blockhash, obj.m_coins_count, obj.m_nchaintx); }
 };
 
+/*
+ * A snapshot file is laid out as:
+ *
+ *  - SnapshotMetadata
+ *  - SnapshotMWEBState, followed by SnapshotMWEBSegments holding all MWEB UTXOs
+ *  - m_coins_count pairs of (COutPoint, Coin)
+ *  - the number of MWEB blocks, followed by the kernels of each of those blocks
+ *
+ * The MWEB state is written before the transparent coins because it is read
+ * from the live MWEB database, while the coins are read from a LevelDB
+ * snapshot that stays consistent after cs_main is released.
+ */
+
+//! Maximum number of MWEB UTXOs in a single snapshot segment.
+static constexpr uint16_t MWEB_SNAPSHOT_SEGMENT_SIZE = 4096;
+
+//! MWEB state at the base block of a UTXO snapshot.
+class SnapshotMWEBState
+{
+public:
+    //! Whether MWEB was active at the base block. The rest is unset if not.
+    bool m_active = false;
+
+    //! The MWEB header, and the HogEx that commits to it with its merkle proof.
+    CMerkleBlockWithMWEB m_proof;
+
+    //! Raw leafset bytes: bit i (most significant bit first) is set if output i is unspent.
+    std::vector<uint8_t> m_leafset;
+
+    //! The number of MWEB UTXOs in the segments that follow.
+    uint64_t m_utxo_count = 0;
+
+    SERIALIZE_METHODS(SnapshotMWEBState, obj)
+    {
+        READWRITE(obj.m_active);
+        if (obj.m_active) {
+            READWRITE(obj.m_proof, obj.m_leafset, obj.m_utxo_count);
+        }
+    }
+};
+
+//! A run of MWEB UTXOs with the hashes needed to recompute the output PMMR root.
+class SnapshotMWEBSegment
+{
+public:
+    uint64_t m_first_leaf_idx = 0;
+    std::vector<UTXO> m_utxos;
+    std::vector<mw::Hash> m_hashes;
+    bool m_has_lower_peak = false;
+    mw::Hash m_lower_peak;
+
+    SERIALIZE_METHODS(SnapshotMWEBSegment, obj)
+    {
+        READWRITE(obj.m_first_leaf_idx, obj.m_utxos, obj.m_hashes, obj.m_has_lower_peak);
+        if (obj.m_has_lower_peak) {
+            READWRITE(obj.m_lower_peak);
+        }
+    }
+};
+
+/**
+ * Write the MWEB state and UTXO segments of `view` as of `base_block`.
+ * The caller must hold cs_main so that `view` does not change meanwhile.
+ * Returns the number of MWEB UTXOs written.
+ */
+uint64_t WriteMWEBSnapshotState(CAutoFile& file, const CBlock& base_block, const mw::ICoinsView& view, const std::function<void()>& interruption_point);
+
+/**
+ * Write the kernels of all MWEB blocks up to and including `base`.
+ * Returns the number of kernels written.
+ */
+uint64_t WriteMWEBSnapshotKernels(CAutoFile& file, const CBlockIndex* base, const Consensus::Params& params, const std::function<void()>& interruption_point);
+
+/**
+ * Reads the MWEB parts of a snapshot and checks them against the block the
+ * snapshot claims as its base:
+ *
+ *  - the MWEB header is committed to by the base block's HogEx;
+ *  - the leafset hashes to the header's leafset root;
+ *  - every UTXO segment recomputes the header's output root, and together
+ *    the segments cover exactly the unspent leaves;
+ *  - the base block's kernels match the header's kernel root;
+ *  - the UTXO commitments balance against all kernels and the header's
+ *    kernel offset, and the kernels' supply change matches the HogEx amount.
+ *
+ * Kernels of earlier blocks are only committed to by those blocks, which a
+ * node loading the snapshot does not have, but forged kernels cannot balance
+ * a proven UTXO set and kernel offset.
+ */
+class SnapshotMWEBValidator
+{
+public:
+    SnapshotMWEBValidator(const CBlockIndex& base, const Consensus::Params& params)
+        : m_base(base), m_params(params) {}
+
+    //! Read and check the MWEB state and UTXO segments.
+    bool ReadState(CAutoFile& file, std::string& error, const std::function<void()>& interruption_point);
+    //! Read the kernels and check the MWEB sums. Must follow ReadState().
+    bool ReadKernels(CAutoFile& file, std::string& error, const std::function<void()>& interruption_point);
+
+    const SnapshotMWEBState& GetState() const { return m_state; }
+    uint64_t GetKernelCount() const { return m_kernel_count; }
+
+private:
+    const CBlockIndex& m_base;
+    const Consensus::Params& m_params;
+    SnapshotMWEBState m_state;
+    //! Sum of the commitments of the UTXOs read by ReadState()
+    Commitment m_utxo_sum;
+    uint64_t m_kernel_count = 0;
+};
+
+/**
+ * Coins view over the transparent coins of a snapshot file, positioned at
+ * the first coin. Provides a single cursor, which reads the coins in order.
+ */
+class SnapshotCoinsView : public CCoinsView
+{
+public:
+    SnapshotCoinsView(CAutoFile& file, const SnapshotMetadata& metadata)
+        : m_file(file), m_metadata(metadata) {}
+
+    uint256 GetBestBlock() const override { return m_metadata.m_base_blockhash; }
+    CCoinsViewCursor* Cursor() const override;
+
+private:
+    CAutoFile& m_file;
+    const SnapshotMetadata& m_metadata;
+};
+
 #endif // BITCOIN_NODE_UTXO_SNAPSHOT_H
@@ -0,0 +1 @@
+#define BUILD_GIT_COMMIT "5761a23-dirty"
@@ -10,6 +10,8 @@
 #include <txmempool.h>
 #include <util/system.h>
 
+#include <cmath>
+
 static constexpr double INF_FEERATE = 1e99;
 
 std::string StringForFeeEstimateHorizon(FeeEstimateHorizon horizon) {
@@ -25,6 +27,17 @@ std::string StringForFeeEstimateHorizon(FeeEstimateHorizon horizon) {
     return horizon_string->second;
 }
 
+/** Version of the fee estimates file format, numbered after the Bitcoin Core
+ * release that introduced it. It is higher than CLIENT_VERSION, as the
+ * versions of this client are numbered lower than Bitcoin Core's. */
+static constexpr int FEE_ESTIMATES_FILE_VERSION = 149900;
+
+/** Fee paid per 1000 units of MWEB weight, which MWEB transactions are also tracked by */
+static double GetMWEBFeePerK(const CTxMemPoolEntry& entry)
+{
+    return entry.GetFee() * 1000.0 / entry.GetMWEBWeight();
+}
+
 /**
  * We will instantiate an instance of this class to track transactions that were
  * included in a block. We will lump transactions into a bucket according to their
@@ -38,7 +51,14 @@ class TxConfirmStats
 private:
     //Define the buckets we will group transactions into
     const std::vector<double>& buckets;              // The upper-bound of the range for the bucket (inclusive)
-    const std::map<double, unsigned int>& bucketMap; // Map of bucket upper-bound to index into all vectors by bucket
+    // Number of buckets, which buckets is only resized to after a successful Read
+    size_t numBuckets;
+    // Number of periods confirmations are tracked for
+    size_t numPeriods;
+
+    // The counters below are kept in flat vectors. Those indexed by a
+    // number of periods Y and a bucket X are stored as [Y * numBuckets + X],
+    // so that each of the loops over all buckets runs over contiguous memory.
 
     // For each bucket X:
     // Count the total # of txs in each bucket
@@ -47,11 +67,19 @@ private:
 
     // Count the total # of txs confirmed within Y blocks in each bucket
     // Track the historical moving average of these totals over blocks
-    std::vector<std::vector<double>> confAvg; // confAvg[Y][X]
+    std::vector<double> confAvg; // confAvg[Y][X]
 
     // Track moving avg of txs which have been evicted from the mempool
     // after failing to be confirmed within Y blocks
-    std::vector<std::vector<double>> failAvg; // failAvg[Y][X]
+    std::vector<double> failAvg; // failAvg[Y][X]
+
+    // Txs confirmed within exactly Y periods, and txs that failed to be
+    // confirmed after exactly Y periods (or more for the last one), which
+    // have not been added to confAvg and failAvg yet. This keeps recording a
+    // tx O(1); ApplyPending() adds the running totals to the averages.
+    std::vector<double> pendingConf; // pendingConf[Y][X]
+    std::vector<double> pendingFail; // pendingFail[Y][X]
+    bool hasPending{false};
 
     // Sum the total feerate of all tx's in each bucket
     // Track the historical moving average of this total over blocks
@@ -67,13 +95,22 @@ private:
 
     // Mempool counts of outstanding transactions
     // For each bucket X, track the number of transactions in the mempool
-    // that are unconfirmed for each possible confirmation value Y
-    std::vector<std::vector<int> > unconfTxs;  //unconfTxs[Y][X]
+    // that are unconfirmed for each possible confirmation value Y. Unlike
+    // the averages these are stored as [X * GetMaxConfirms() + Y], as
+    // EstimateMedianVal() sums them over Y for one bucket at a time.
+    std::vector<int> unconfTxs;  //unconfTxs[X][Y]
     // transactions still unconfirmed after GetMaxConfirms for each bucket
     std::vector<int> oldUnconfTxs;
 
     void resizeInMemoryCounters(size_t newbuckets);
 
+    /**
+     * Write one of the [Y][X] averages to a file in its nested layout, with
+     * the pending data points added. count_longer tells whether a data point
+     * for Y periods counts for all longer periods, or all shorter ones.
+     */
+    void WriteAverages(CAutoFile& fileout, const std::vector<double>& avg, const std::vector<double>& pending, bool count_longer) const;
+
 public:
     /**
      * Create new TxConfirmStats. This is called by BlockPolicyEstimator's
@@ -82,7 +119,7 @@ public:
      * @param maxPeriods max number of periods to track
      * @param decay how much to decay the historical moving average per block
      */
-    TxConfirmStats(const std::vector<double>& defaultBuckets, const std::map<double, unsigned int>& defaultBucketMap,
+    TxConfirmStats(const std::vector<double>& defaultBuckets,
                    unsigned int maxPeriods, double decay, unsigned int scale);
 
     /** Roll the circular buffer for unconfirmed txs*/
@@ -91,18 +128,22 @@ public:
     /**
      * Record a new transaction data point in the current block stats
      * @param blocksToConfirm the number of blocks it took this transaction to confirm
+     * @param bucketindex the bucket of the transaction's feerate
      * @param val the feerate of the transaction
      * @warning blocksToConfirm is 1-based and has to be >= 1
      */
-    void Record(int blocksToConfirm, double val);
+    void Record(int blocksToConfirm, unsigned int bucketindex, double val);
 
     /** Record a new transaction entering the mempool*/
-    unsigned int NewTx(unsigned int nBlockHeight, double val);
+    void NewTx(unsigned int nBlockHeight, unsigned int bucketindex);
 
     /** Remove a transaction from mempool tracking stats*/
     void removeTx(unsigned int entryHeight, unsigned int nBestSeenHeight,
                   unsigned int bucketIndex, bool inBlock);
 
+    /** Add the data points recorded since the last call to the moving averages */
+    void ApplyPending();
+
     /** Update our estimates by decaying our historical moving average and updating
         with the data gathered from the current block */
     void UpdateMovingAverages();
@@ -121,7 +162,7 @@ public:
                              EstimationResult *result = nullptr) const;
 
     /** Return the max number of confirms we're tracking */
-    unsigned int GetMaxConfirms() const { return scale * confAvg.size(); }
+    unsigned int GetMaxConfirms() const { return scale * numPeriods; }
 
     /** Write state of estimation data to a file*/
     void Write(CAutoFile& fileout) const;
@@ -130,73 +171,92 @@ public:
      * Read saved state of estimation data from a file and replace all internal data structures and
      * variables with this state.
      */
-    void Read(CAutoFile& filein, int nFileVersion, size_t numBuckets);
+    void Read(CAutoFile& filein, int nFileVersion, size_t num_buckets);
 };
 
 
 TxConfirmStats::TxConfirmStats(const std::vector<double>& defaultBuckets,
-                                const std::map<double, unsigned int>& defaultBucketMap,
                                unsigned int maxPeriods, double _decay, unsigned int _scale)
-    : buckets(defaultBuckets), bucketMap(defaultBucketMap), decay(_decay), scale(_scale)
+    : buckets(defaultBuckets), numBuckets(defaultBuckets.size()), numPeriods(maxPeriods), decay(_decay), scale(_scale)
 {
     assert(_scale != 0 && "_scale must be non-zero");
-    confAvg.resize(maxPeriods);
-    failAvg.resize(maxPeriods);
-    for (unsigned int i = 0; i < maxPeriods; i++) {
-        confAvg[i].resize(buckets.size());
-        failAvg[i].resize(buckets.size());
-    }
+    confAvg.resize(numPeriods * numBuckets);
+    failAvg.resize(numPeriods * numBuckets);
 
-    txCtAvg.resize(buckets.size());
-    m_feerate_avg.resize(buckets.size());
+    txCtAvg.resize(numBuckets);
+    m_feerate_avg.resize(numBuckets);
 
-    resizeInMemoryCounters(buckets.size());
+    resizeInMemoryCounters(numBuckets);
 }
 
 void TxConfirmStats::resizeInMemoryCounters(size_t newbuckets) {
     // newbuckets must be passed in because the buckets referred to during Read have not been updated yet.
-    unconfTxs.resize(GetMaxConfirms());
-    for (unsigned int i = 0; i < unconfTxs.size(); i++) {
-        unconfTxs[i].resize(newbuckets);
-    }
-    oldUnconfTxs.resize(newbuckets);
+    numBuckets = newbuckets;
+    unconfTxs.assign(GetMaxConfirms() * newbuckets, 0);
+    oldUnconfTxs.assign(newbuckets, 0);
+    pendingConf.assign(numPeriods * newbuckets, 0);
+    pendingFail.assign(numPeriods * newbuckets, 0);
+    hasPending = false;
 }
 
 // Roll the unconfirmed txs circular buffer
 void TxConfirmStats::ClearCurrent(unsigned int nBlockHeight)
 {
-    for (unsigned int j = 0; j < buckets.size(); j++) {
-        oldUnconfTxs[j] += unconfTxs[nBlockHeight % unconfTxs.size()][j];
-        unconfTxs[nBlockHeight%unconfTxs.size()][j] = 0;
+    const unsigned int bins = GetMaxConfirms();
+    for (unsigned int j = 0; j < numBuckets; j++) {
+        int& current = unconfTxs[j * bins + nBlockHeight % bins];
+        oldUnconfTxs[j] += current;
+        current = 0;
     }
 }
 
 
-void TxConfirmStats::Record(int blocksToConfirm, double feerate)
+void TxConfirmStats::Record(int blocksToConfirm, unsigned int bucketindex, double feerate)
 {
     // blocksToConfirm is 1-based
     if (blocksToConfirm < 1)
         return;
-    int periodsToConfirm = (blocksToConfirm + scale - 1) / scale;
-    unsigned int bucketindex = bucketMap.lower_bound(feerate)->second;
-    for (size_t i = periodsToConfirm; i <= confAvg.size(); i++) {
-        confAvg[i - 1][bucketindex]++;
+    unsigned int periodsToConfirm = (blocksToConfirm + scale - 1) / scale;
+    if (periodsToConfirm <= numPeriods) {
+        pendingConf[(periodsToConfirm - 1) * numBuckets + bucketindex]++;
+        hasPending = true;
     }
     txCtAvg[bucketindex]++;
     m_feerate_avg[bucketindex] += feerate;
 }
 
-void TxConfirmStats::UpdateMovingAverages()
+void TxConfirmStats::ApplyPending()
 {
-    assert(confAvg.size() == failAvg.size());
-    for (unsigned int j = 0; j < buckets.size(); j++) {
-        for (unsigned int i = 0; i < confAvg.size(); i++) {
-            confAvg[i][j] *= decay;
-            failAvg[i][j] *= decay;
+    if (!hasPending) return;
+    // A tx confirmed within Y periods counts for Y and all longer periods,
+    // and one that failed after Y periods for Y and all shorter ones
+    for (size_t i = 0; i < numPeriods; i++) {
+        const size_t row = i * numBuckets;
+        for (size_t j = 0; j < numBuckets; j++) {
+            if (i > 0) pendingConf[row + j] += pendingConf[row - numBuckets + j];
+            confAvg[row + j] += pendingConf[row + j];
+        }
+    }
+    for (size_t i = numPeriods; i-- > 0;) {
+        const size_t row = i * numBuckets;
+        for (size_t j = 0; j < numBuckets; j++) {
+            if (i + 1 < numPeriods) pendingFail[row + j] += pendingFail[row + numBuckets + j];
+            failAvg[row + j] += pendingFail[row + j];
         }
-        m_feerate_avg[j] *= decay;
-        txCtAvg[j] *= decay;
     }
+    std::fill(pendingConf.begin(), pendingConf.end(), 0);
+    std::fill(pendingFail.begin(), pendingFail.end(), 0);
+    hasPending = false;
+}
+
+void TxConfirmStats::UpdateMovingAverages()
+{
+    // Failures recorded since the last block are decayed along with the rest
+    ApplyPending();
+    for (double& avg : confAvg) avg *= decay;
+    for (double& avg : failAvg) avg *= decay;
+    for (double& avg : m_feerate_avg) avg *= decay;
+    for (double& avg : txCtAvg) avg *= decay;
 }
 
 // returns -1 on error conditions
@@ -210,7 +270,9 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     int extraNum = 0;  // Number of tx's still in mempool for confTarget or longer
     double failNum = 0; // Number of tx's that were never confirmed but removed from the mempool after confTarget
     const int periodTarget = (confTarget + scale - 1) / scale;
-    const int maxbucketindex = buckets.size() - 1;
+    const int maxbucketindex = numBuckets - 1;
+    const double* confTarget_avg = &confAvg[(periodTarget - 1) * numBuckets];
+    const double* failTarget_avg = &failAvg[(periodTarget - 1) * numBuckets];
 
     // We'll combine buckets until we have enough samples.
     // The near and far variables will define the range we've combined
@@ -223,7 +285,7 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     unsigned int bestFarBucket = maxbucketindex;
 
     bool foundAnswer = false;
-    unsigned int bins = unconfTxs.size();
+    unsigned int bins = GetMaxConfirms();
     bool newBucketRange = true;
     bool passing = true;
     EstimatorBucket passBucket;
@@ -236,11 +298,12 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
             newBucketRange = false;
         }
         curFarBucket = bucket;
-        nConf += confAvg[periodTarget - 1][bucket];
+        nConf += confTarget_avg[bucket];
         totalNum += txCtAvg[bucket];
-        failNum += failAvg[periodTarget - 1][bucket];
-        for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
-            extraNum += unconfTxs[(nBlockHeight - confct) % bins][bucket];
+        failNum += failTarget_avg[bucket];
+        const int* bucket_unconf = &unconfTxs[bucket * bins];
+        for (unsigned int confct = confTarget; confct < bins; confct++)
+            extraNum += bucket_unconf[(nBlockHeight - confct) % bins];
         extraNum += oldUnconfTxs[bucket];
         // If we have enough transaction data points in this range of buckets,
         // we can test for success
@@ -353,20 +416,34 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     return median;
 }
 
+void TxConfirmStats::WriteAverages(CAutoFile& fileout, const std::vector<double>& avg, const std::vector<double>& pending, bool count_longer) const
+{
+    std::vector<std::vector<double>> nested(numPeriods, std::vector<double>(numBuckets));
+    std::vector<double> running(numBuckets);
+    for (size_t n = 0; n < numPeriods; n++) {
+        const size_t i = count_longer ? n : numPeriods - 1 - n;
+        for (size_t j = 0; j < numBuckets; j++) {
+            running[j] += pending[i * numBuckets + j];
+            nested[i][j] = avg[i * numBuckets + j] + running[j];
+        }
+    }
+    fileout << nested;
+}
+
 void TxConfirmStats::Write(CAutoFile& fileout) const
 {
     fileout << decay;
     fileout << scale;
     fileout << m_feerate_avg;
     fileout << txCtAvg;
-    fileout << confAvg;
-    fileout << failAvg;
+    WriteAverages(fileout, confAvg, pendingConf, true);
+    WriteAverages(fileout, failAvg, pendingFail, false);
 }
 
-void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets)
+void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t num_buckets)
 {
     // Read data file and do some very basic sanity checking
-    // buckets and bucketMap are not updated yet, so don't access them
+    // buckets is not updated yet, so don't access it
     // If there is a read failure, we'll just discard this entire object anyway
     size_t maxConfirms, maxPeriods;
 
@@ -381,50 +458,58 @@ void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets
     }
 
     filein >> m_feerate_avg;
-    if (m_feerate_avg.size() != numBuckets) {
+    if (m_feerate_avg.size() != num_buckets) {
         throw std::runtime_error("Corrupt estimates file. Mismatch in feerate average bucket count");
     }
     filein >> txCtAvg;
-    if (txCtAvg.size() != numBuckets) {
+    if (txCtAvg.size() != num_buckets) {
         throw std::runtime_error("Corrupt estimates file. Mismatch in tx count bucket count");
     }
-    filein >> confAvg;
-    maxPeriods = confAvg.size();
+    std::vector<std::vector<double>> fileConfAvg;
+    filein >> fileConfAvg;
+    maxPeriods = fileConfAvg.size();
     maxConfirms = scale * maxPeriods;
 
     if (maxConfirms <= 0 || maxConfirms > 6 * 24 * 7) { // one week
         throw std::runtime_error("Corrupt estimates file.  Must maintain estimates for between 1 and 1008 (one week) confirms");
     }
     for (unsigned int i = 0; i < maxPeriods; i++) {
-        if (confAvg[i].size() != numBuckets) {
+        if (fileConfAvg[i].size() != num_buckets) {
             throw std::runtime_error("Corrupt estimates file. Mismatch in feerate conf average bucket count");
         }
     }
 
-    filein >> failAvg;
-    if (maxPeriods != failAvg.size()) {
+    std::vector<std::vector<double>> fileFailAvg;
+    filein >> fileFailAvg;
+    if (maxPeriods != fileFailAvg.size()) {
         throw std::runtime_error("Corrupt estimates file. Mismatch in confirms tracked for failures");
     }
     for (unsigned int i = 0; i < maxPeriods; i++) {
-        if (failAvg[i].size() != numBuckets) {
+        if (fileFailAvg[i].size() != num_buckets) {
             throw std::runtime_error("Corrupt estimates file. Mismatch in one of failure average bucket counts");
         }
     }
 
+    numPeriods = maxPeriods;
+    confAvg.clear();
+    failAvg.clear();
+    for (unsigned int i = 0; i < maxPeriods; i++) {
+        confAvg.insert(confAvg.end(), fileConfAvg[i].begin(), fileConfAvg[i].end());
+        failAvg.insert(failAvg.end(), fileFailAvg[i].begin(), fileFailAvg[i].end());
+    }
+
     // Resize the current block variables which aren't stored in the data file
     // to match the number of confirms and buckets
-    resizeInMemoryCounters(numBuckets);
+    resizeInMemoryCounters(num_buckets);
 
     LogPrint(BCLog::ESTIMATEFEE, "Reading estimates: %u buckets counting confirms up to %u blocks\n",
-             numBuckets, maxConfirms);
+             num_buckets, maxConfirms);
 }
 
-unsigned int TxConfirmStats::NewTx(unsigned int nBlockHeight, double val)
+void TxConfirmStats::NewTx(unsigned int nBlockHeight, unsigned int bucketindex)
 {
-    unsigned int bucketindex = bucketMap.lower_bound(val)->second;
-    unsigned int blockIndex = nBlockHeight % unconfTxs.size();
-    unconfTxs[blockIndex][bucketindex]++;
-    return bucketindex;
+    const unsigned int bins = GetMaxConfirms();
+    unconfTxs[bucketindex * bins + nBlockHeight % bins]++;
 }
 
 void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHeight, unsigned int bucketindex, bool inBlock)
@@ -438,7 +523,8 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         return;  //This can't happen because we call this with our best seen height, no entries can have higher
     }
 
-    if (blocksAgo >= (int)unconfTxs.size()) {
+    const unsigned int bins = GetMaxConfirms();
+    if (blocksAgo >= (int)bins) {
         if (oldUnconfTxs[bucketindex] > 0) {
             oldUnconfTxs[bucketindex]--;
         } else {
@@ -447,9 +533,9 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         }
     }
     else {
-        unsigned int blockIndex = entryHeight % unconfTxs.size();
-        if (unconfTxs[blockIndex][bucketindex] > 0) {
-            unconfTxs[blockIndex][bucketindex]--;
+        unsigned int blockIndex = entryHeight % bins;
+        if (unconfTxs[bucketindex * bins + blockIndex] > 0) {
+            unconfTxs[bucketindex * bins + blockIndex]--;
         } else {
             LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy error, mempool tx removed from blockIndex=%u,bucketIndex=%u already\n",
                      blockIndex, bucketindex);
@@ -457,10 +543,9 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
     }
     if (!inBlock && (unsigned int)blocksAgo >= scale) { // Only counts as a failure if not confirmed for entire period
         assert(scale != 0);
-        unsigned int periodsAgo = blocksAgo / scale;
-        for (size_t i = 0; i < periodsAgo && i < failAvg.size(); i++) {
-            failAvg[i][bucketindex]++;
-        }
+        size_t periodsAgo = std::min<size_t>(blocksAgo / scale, numPeriods);
+        pendingFail[(periodsAgo - 1) * numBuckets + bucketindex]++;
+        hasPending = true;
     }
 }
 
@@ -474,9 +559,16 @@ bool CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
     LOCK(m_cs_fee_estimator);
     std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
     if (pos != mapMemPoolTxs.end()) {
-        feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
-        shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
-        longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+        if (pos->second.bucketIndex != NO_BUCKET) {
+            feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+            shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+            longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+        }
+        if (pos->second.mwebBucketIndex != NO_BUCKET) {
+            mwebFeeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.mwebBucketIndex, inBlock);
+            mwebShortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.mwebBucketIndex, inBlock);
+            mwebLongStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.mwebBucketIndex, inBlock);
+        }
         mapMemPoolTxs.erase(hash);
         return true;
     } else {
@@ -488,24 +580,65 @@ CBlockPolicyEstimator::CBlockPolicyEstimator()
     : nBestSeenHeight(0), firstRecordedHeight(0), historicalFirst(0), historicalBest(0), trackedTxs(0), untrackedTxs(0)
 {
     static_assert(MIN_BUCKET_FEERATE > 0, "Min feerate must be nonzero");
-    size_t bucketIndex = 0;
-    for (double bucketBoundary = MIN_BUCKET_FEERATE; bucketBoundary <= MAX_BUCKET_FEERATE; bucketBoundary *= FEE_SPACING, bucketIndex++) {
+    for (double bucketBoundary = MIN_BUCKET_FEERATE; bucketBoundary <= MAX_BUCKET_FEERATE; bucketBoundary *= FEE_SPACING) {
         buckets.push_back(bucketBoundary);
-        bucketMap[bucketBoundary] = bucketIndex;
     }
     buckets.push_back(INF_FEERATE);
-    bucketMap[INF_FEERATE] = bucketIndex;
-    assert(bucketMap.size() == buckets.size());
 
-    feeStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
-    shortStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
-    longStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
+    feeStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
+    shortStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
+    longStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
+    mwebFeeStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
+    mwebShortStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
+    mwebLongStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
 }
 
 CBlockPolicyEstimator::~CBlockPolicyEstimator()
 {
 }
 
+unsigned int CBlockPolicyEstimator::GetBucketIndex(double feerate) const
+{
+    // The buckets are spaced FEE_SPACING apart, so the index can be computed
+    // instead of searched for. Check it against the bucket boundaries, which
+    // may have been read from a file, and fall back to a binary search.
+    static const double log_fee_spacing = std::log(FEE_SPACING);
+    const size_t last = buckets.size() - 1;
+    size_t index = 0;
+    if (feerate > buckets[0]) {
+        index = std::min<double>(std::ceil(std::log(feerate / buckets[0]) / log_fee_spacing), last);
+        // Correct rounding errors
+        if (index > 0 && buckets[index - 1] >= feerate) {
+            --index;
+        } else if (index < last && buckets[index] < feerate) {
+            ++index;
+        }
+    }
+    if (buckets[index] >= feerate && (index == 0 || buckets[index - 1] < feerate)) {
+        return index;
+    }
+    return std::min<size_t>(std::lower_bound(buckets.begin(), buckets.end(), feerate) - buckets.begin(), last);
+}
+
+TxConfirmStats& CBlockPolicyEstimator::GetStats(FeeEstimateHorizon horizon, FeeEstimateDimension dimension) const
+{
+    const bool mweb = dimension == FeeEstimateDimension::MWEB_WEIGHT;
+    switch (horizon) {
+    case FeeEstimateHorizon::SHORT_HALFLIFE: {
+        return mweb ? *mwebShortStats : *shortStats;
+    }
+    case FeeEstimateHorizon::MED_HALFLIFE: {
+        return mweb ? *mwebFeeStats : *feeStats;
+    }
+    case FeeEstimateHorizon::LONG_HALFLIFE: {
+        return mweb ? *mwebLongStats : *longStats;
+    }
+    default: {
+        throw std::out_of_range("CBlockPolicyEstimator::GetStats unknown FeeEstimateHorizon");
+    }
+    }
+}
+
 void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, bool validFeeEstimate)
 {
     LOCK(m_cs_fee_estimator);
@@ -533,24 +666,33 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     }
     trackedTxs++;
 
-    // Feerates are stored and reported as BTC-per-kb:
-    CFeeRate feeRate(entry.GetFee(), entry.GetTxSize(), entry.GetMWEBWeight());
-
-    mapMemPoolTxs[hash].blockHeight = txHeight;
-    unsigned int bucketIndex = feeStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
-    mapMemPoolTxs[hash].bucketIndex = bucketIndex;
-    unsigned int bucketIndex2 = shortStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
-    assert(bucketIndex == bucketIndex2);
-    unsigned int bucketIndex3 = longStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
-    assert(bucketIndex == bucketIndex3);
+    TxStatsInfo& info = mapMemPoolTxs[hash];
+    info.blockHeight = txHeight;
+    if (entry.GetTxSize() > 0) {
+        // Feerates are stored and reported as BTC-per-kb:
+        CFeeRate feeRate(entry.GetFee(), entry.GetTxSize(), entry.GetMWEBWeight());
+        info.bucketIndex = GetBucketIndex(feeRate.GetFeePerK());
+        feeStats->NewTx(txHeight, info.bucketIndex);
+        shortStats->NewTx(txHeight, info.bucketIndex);
+        longStats->NewTx(txHeight, info.bucketIndex);
+    }
+    if (entry.GetMWEBWeight() > 0) {
+        info.mwebBucketIndex = GetBucketIndex(GetMWEBFeePerK(entry));
+        mwebFeeStats->NewTx(txHeight, info.mwebBucketIndex);
+        mwebShortStats->NewTx(txHeight, info.mwebBucketIndex);
+        mwebLongStats->NewTx(txHeight, info.mwebBucketIndex);
+    }
 }
 
 bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry)
 {
-    if (!removeTx(entry->GetTx().GetHash(), true)) {
+    std::map<uint256, TxStatsInfo>::const_iterator pos = mapMemPoolTxs.find(entry->GetTx().GetHash());
+    if (pos == mapMemPoolTxs.end()) {
         // This transaction wasn't being tracked for fee estimation
         return false;
     }
+    const TxStatsInfo info = pos->second;
+    removeTx(entry->GetTx().GetHash(), true);
 
     // How many blocks did it take for miners to include this transaction?
     // blocksToConfirm is 1-based, so a transaction included in the earliest
@@ -563,12 +705,20 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
         return false;
     }
 
-    // Feerates are stored and reported as BTC-per-kb:
-    CFeeRate feeRate(entry->GetFee(), entry->GetTxSize(), entry->GetMWEBWeight());
+    if (info.bucketIndex != NO_BUCKET) {
+        // Feerates are stored and reported as BTC-per-kb:
+        CFeeRate feeRate(entry->GetFee(), entry->GetTxSize(), entry->GetMWEBWeight());
 
-    feeStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
-    shortStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
-    longStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
+        feeStats->Record(blocksToConfirm, info.bucketIndex, (double)feeRate.GetFeePerK());
+        shortStats->Record(blocksToConfirm, info.bucketIndex, (double)feeRate.GetFeePerK());
+        longStats->Record(blocksToConfirm, info.bucketIndex, (double)feeRate.GetFeePerK());
+    }
+    if (info.mwebBucketIndex != NO_BUCKET) {
+        const double mwebFeePerK = GetMWEBFeePerK(*entry);
+        mwebFeeStats->Record(blocksToConfirm, info.mwebBucketIndex, mwebFeePerK);
+        mwebShortStats->Record(blocksToConfirm, info.mwebBucketIndex, mwebFeePerK);
+        mwebLongStats->Record(blocksToConfirm, info.mwebBucketIndex, mwebFeePerK);
+    }
     return true;
 }
 
@@ -590,15 +740,14 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     // of unconfirmed txs to remove from tracking.
     nBestSeenHeight = nBlockHeight;
 
-    // Update unconfirmed circular buffer
-    feeStats->ClearCurrent(nBlockHeight);
-    shortStats->ClearCurrent(nBlockHeight);
-    longStats->ClearCurrent(nBlockHeight);
-
-    // Decay all exponential averages
-    feeStats->UpdateMovingAverages();
-    shortStats->UpdateMovingAverages();
-    longStats->UpdateMovingAverages();
+    const std::vector<TxConfirmStats*> all_stats{feeStats.get(), shortStats.get(), longStats.get(),
+                                                 mwebFeeStats.get(), mwebShortStats.get(), mwebLongStats.get()};
+    for (TxConfirmStats* stats : all_stats) {
+        // Update unconfirmed circular buffer
+        stats->ClearCurrent(nBlockHeight);
+        // Decay all exponential averages
+        stats->UpdateMovingAverages();
+    }
 
     unsigned int countedTxs = 0;
     // Update averages with data points from current block
@@ -606,6 +755,10 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
         if (processBlockTx(nBlockHeight, entry))
             countedTxs++;
     }
+    for (TxConfirmStats* stats : all_stats) {
+        stats->ApplyPending();
+    }
+    m_estimate_cache.clear();
 
     if (firstRecordedHeight == 0 && countedTxs > 0) {
         firstRecordedHeight = nBestSeenHeight;
@@ -715,32 +868,35 @@ unsigned int CBlockPolicyEstimator::MaxUsableEstimate() const
  * time horizon which tracks confirmations up to the desired target.  If
  * checkShorterHorizon is requested, also allow short time horizon estimates
  * for a lower target to reduce the given answer */
-double CBlockPolicyEstimator::estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const
+double CBlockPolicyEstimator::estimateCombinedFee(FeeEstimateDimension dimension, unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const
 {
+    const TxConfirmStats& short_stats = GetStats(FeeEstimateHorizon::SHORT_HALFLIFE, dimension);
+    const TxConfirmStats& med_stats = GetStats(FeeEstimateHorizon::MED_HALFLIFE, dimension);
+    const TxConfirmStats& long_stats = GetStats(FeeEstimateHorizon::LONG_HALFLIFE, dimension);
     double estimate = -1;
-    if (confTarget >= 1 && confTarget <= longStats->GetMaxConfirms()) {
+    if (confTarget >= 1 && confTarget <= long_stats.GetMaxConfirms()) {
         // Find estimate from shortest time horizon possible
-        if (confTarget <= shortStats->GetMaxConfirms()) { // short horizon
-            estimate = shortStats->EstimateMedianVal(confTarget, SUFFICIENT_TXS_SHORT, successThreshold, nBestSeenHeight, result);
+        if (confTarget <= short_stats.GetMaxConfirms()) { // short horizon
+            estimate = short_stats.EstimateMedianVal(confTarget, SUFFICIENT_TXS_SHORT, successThreshold, nBestSeenHeight, result);
         }
-        else if (confTarget <= feeStats->GetMaxConfirms()) { // medium horizon
-            estimate = feeStats->EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, nBestSeenHeight, result);
+        else if (confTarget <= med_stats.GetMaxConfirms()) { // medium horizon
+            estimate = med_stats.EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, nBestSeenHeight, result);
         }
         else { // long horizon
-            estimate = longStats->EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, nBestSeenHeight, result);
+            estimate = long_stats.EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, nBestSeenHeight, result);
         }
         if (checkShorterHorizon) {
             EstimationResult tempResult;
             // If a lower confTarget from a more recent horizon returns a lower answer use it.
-            if (confTarget > feeStats->GetMaxConfirms()) {
-                double medMax = feeStats->EstimateMedianVal(feeStats->GetMaxConfirms(), SUFFICIENT_FEETXS, successThreshold, nBestSeenHeight, &tempResult);
+            if (confTarget > med_stats.GetMaxConfirms()) {
+                double medMax = med_stats.EstimateMedianVal(med_stats.GetMaxConfirms(), SUFFICIENT_FEETXS, successThreshold, nBestSeenHeight, &tempResult);
                 if (medMax > 0 && (estimate == -1 || medMax < estimate)) {
                     estimate = medMax;
                     if (result) *result = tempResult;
                 }
             }
-            if (confTarget > shortStats->GetMaxConfirms()) {
-                double shortMax = shortStats->EstimateMedianVal(shortStats->GetMaxConfirms(), SUFFICIENT_TXS_SHORT, successThreshold, nBestSeenHeight, &tempResult);
+            if (confTarget > short_stats.GetMaxConfirms()) {
+                double shortMax = short_stats.EstimateMedianVal(short_stats.GetMaxConfirms(), SUFFICIENT_TXS_SHORT, successThreshold, nBestSeenHeight, &tempResult);
                 if (shortMax > 0 && (estimate == -1 || shortMax < estimate)) {
                     estimate = shortMax;
                     if (result) *result = tempResult;
@@ -754,15 +910,18 @@ double CBlockPolicyEstimator::estimateCombinedFee(unsigned int confTarget, doubl
 /** Ensure that for a conservative estimate, the DOUBLE_SUCCESS_PCT is also met
  * at 2 * target for any longer time horizons.
  */
-double CBlockPolicyEstimator::estimateConservativeFee(unsigned int doubleTarget, EstimationResult *result) const
+double CBlockPolicyEstimator::estimateConservativeFee(FeeEstimateDimension dimension, unsigned int doubleTarget, EstimationResult *result) const
 {
+    const TxConfirmStats& short_stats = GetStats(FeeEstimateHorizon::SHORT_HALFLIFE, dimension);
+    const TxConfirmStats& med_stats = GetStats(FeeEstimateHorizon::MED_HALFLIFE, dimension);
+    const TxConfirmStats& long_stats = GetStats(FeeEstimateHorizon::LONG_HALFLIFE, dimension);
     double estimate = -1;
     EstimationResult tempResult;
-    if (doubleTarget <= shortStats->GetMaxConfirms()) {
-        estimate = feeStats->EstimateMedianVal(doubleTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, nBestSeenHeight, result);
+    if (doubleTarget <= short_stats.GetMaxConfirms()) {
+        estimate = med_stats.EstimateMedianVal(doubleTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, nBestSeenHeight, result);
     }
-    if (doubleTarget <= feeStats->GetMaxConfirms()) {
-        double longEstimate = longStats->EstimateMedianVal(doubleTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, nBestSeenHeight, &tempResult);
+    if (doubleTarget <= med_stats.GetMaxConfirms()) {
+        double longEstimate = long_stats.EstimateMedianVal(doubleTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, nBestSeenHeight, &tempResult);
         if (longEstimate > estimate) {
             estimate = longEstimate;
             if (result) *result = tempResult;
@@ -778,10 +937,8 @@ double CBlockPolicyEstimator::estimateConservativeFee(unsigned int doubleTarget,
  * estimates, however, required the 95% threshold at 2 * target be met for any
  * longer time horizons also.
  */
-CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative) const
+CFeeRate CBlockPolicyEstimator::calculateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative, FeeEstimateDimension dimension) const
 {
-    LOCK(m_cs_fee_estimator);
-
     if (feeCalc) {
         feeCalc->desiredTarget = confTarget;
         feeCalc->returnedTarget = confTarget;
@@ -791,7 +948,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
     EstimationResult tempResult;
 
     // Return failure if trying to analyze a target we're not tracking
-    if (confTarget <= 0 || (unsigned int)confTarget > longStats->GetMaxConfirms()) {
+    if (confTarget <= 0 || (unsigned int)confTarget > GetStats(FeeEstimateHorizon::LONG_HALFLIFE, dimension).GetMaxConfirms()) {
         return CFeeRate(0);  // error condition
     }
 
@@ -817,13 +974,13 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
      * the purpose of conservative estimates is not to let short term
      * fluctuations lower our estimates by too much.
      */
-    double halfEst = estimateCombinedFee(confTarget/2, HALF_SUCCESS_PCT, true, &tempResult);
+    double halfEst = estimateCombinedFee(dimension, confTarget/2, HALF_SUCCESS_PCT, true, &tempResult);
     if (feeCalc) {
         feeCalc->est = tempResult;
         feeCalc->reason = FeeReason::HALF_ESTIMATE;
     }
     median = halfEst;
-    double actualEst = estimateCombinedFee(confTarget, SUCCESS_PCT, true, &tempResult);
+    double actualEst = estimateCombinedFee(dimension, confTarget, SUCCESS_PCT, true, &tempResult);
     if (actualEst > median) {
         median = actualEst;
         if (feeCalc) {
@@ -831,7 +988,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
             feeCalc->reason = FeeReason::FULL_ESTIMATE;
         }
     }
-    double doubleEst = estimateCombinedFee(2 * confTarget, DOUBLE_SUCCESS_PCT, !conservative, &tempResult);
+    double doubleEst = estimateCombinedFee(dimension, 2 * confTarget, DOUBLE_SUCCESS_PCT, !conservative, &tempResult);
     if (doubleEst > median) {
         median = doubleEst;
         if (feeCalc) {
@@ -841,7 +998,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
     }
 
     if (conservative || median == -1) {
-        double consEst =  estimateConservativeFee(2 * confTarget, &tempResult);
+        double consEst =  estimateConservativeFee(dimension, 2 * confTarget, &tempResult);
         if (consEst > median) {
             median = consEst;
             if (feeCalc) {
@@ -856,12 +1013,29 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
     return CFeeRate(llround(median));
 }
 
+CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative, FeeEstimateDimension dimension) const
+{
+    LOCK(m_cs_fee_estimator);
+
+    // Data points are only added to the moving averages with each block, so
+    // each estimate is calculated once per block
+    const auto key = std::make_tuple(confTarget, conservative, dimension);
+    auto cached = m_estimate_cache.find(key);
+    if (cached == m_estimate_cache.end()) {
+        CachedEstimate estimate;
+        estimate.feeRate = calculateSmartFee(confTarget, &estimate.feeCalc, conservative, dimension);
+        cached = m_estimate_cache.emplace(key, estimate).first;
+    }
+    if (feeCalc) *feeCalc = cached->second.feeCalc;
+    return cached->second.feeRate;
+}
+
 
 bool CBlockPolicyEstimator::Write(CAutoFile& fileout) const
 {
     try {
         LOCK(m_cs_fee_estimator);
-        fileout << 149900; // version required to read: 0.14.99 or later
+        fileout << FEE_ESTIMATES_FILE_VERSION; // version required to read: 0.14.99 or later
         fileout << CLIENT_VERSION; // version that wrote the file
         fileout << nBestSeenHeight;
         if (BlockSpan() > HistoricalBlockSpan()/2) {
@@ -874,6 +1048,9 @@ bool CBlockPolicyEstimator::Write(CAutoFile& fileout) const
         feeStats->Write(fileout);
         shortStats->Write(fileout);
         longStats->Write(fileout);
+        mwebFeeStats->Write(fileout);
+        mwebShortStats->Write(fileout);
+        mwebLongStats->Write(fileout);
     }
     catch (const std::exception&) {
         LogPrintf("CBlockPolicyEstimator::Write(): unable to write policy estimator data (non-fatal)\n");
@@ -888,7 +1065,7 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
         LOCK(m_cs_fee_estimator);
         int nVersionRequired, nVersionThatWrote;
         filein >> nVersionRequired >> nVersionThatWrote;
-        if (nVersionRequired > CLIENT_VERSION)
+        if (nVersionRequired > std::max(CLIENT_VERSION, FEE_ESTIMATES_FILE_VERSION))
             return error("CBlockPolicyEstimator::Read(): up-version (%d) fee estimate file", nVersionRequired);
 
         // Read fee estimates file into temporary variables so existing data
@@ -896,7 +1073,7 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
         unsigned int nFileBestSeenHeight;
         filein >> nFileBestSeenHeight;
 
-        if (nVersionRequired < 149900) {
+        if (nVersionRequired < FEE_ESTIMATES_FILE_VERSION) {
             LogPrintf("%s: incompatible old fee estimation data (non-fatal). Version: %d\n", __func__, nVersionRequired);
         } else { // New format introduced in 149900
             unsigned int nFileHistoricalFirst, nFileHistoricalBest;
@@ -910,25 +1087,44 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
             if (numBuckets <= 1 || numBuckets > 1000)
                 throw std::runtime_error("Corrupt estimates file. Must have between 2 and 1000 feerate buckets");
 
-            std::unique_ptr<TxConfirmStats> fileFeeStats(new TxConfirmStats(buckets, bucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
-            std::unique_ptr<TxConfirmStats> fileShortStats(new TxConfirmStats(buckets, bucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
-            std::unique_ptr<TxConfirmStats> fileLongStats(new TxConfirmStats(buckets, bucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
+            std::unique_ptr<TxConfirmStats> fileFeeStats(new TxConfirmStats(buckets, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
+            std::unique_ptr<TxConfirmStats> fileShortStats(new TxConfirmStats(buckets, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
+            std::unique_ptr<TxConfirmStats> fileLongStats(new TxConfirmStats(buckets, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
             fileFeeStats->Read(filein, nVersionThatWrote, numBuckets);
             fileShortStats->Read(filein, nVersionThatWrote, numBuckets);
             fileLongStats->Read(filein, nVersionThatWrote, numBuckets);
 
+            std::unique_ptr<TxConfirmStats> fileMWEBFeeStats(new TxConfirmStats(buckets, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
+            std::unique_ptr<TxConfirmStats> fileMWEBShortStats(new TxConfirmStats(buckets, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
+            std::unique_ptr<TxConfirmStats> fileMWEBLongStats(new TxConfirmStats(buckets, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
+            bool fileHasMWEBStats = true;
+            try {
+                fileMWEBFeeStats->Read(filein, nVersionThatWrote, numBuckets);
+                fileMWEBShortStats->Read(filein, nVersionThatWrote, numBuckets);
+                fileMWEBLongStats->Read(filein, nVersionThatWrote, numBuckets);
+            } catch (const std::ios_base::failure&) {
+                // Files written before MWEB transactions were tracked separately end here
+                fileHasMWEBStats = false;
+            }
+
             // Fee estimates file parsed correctly
-            // Copy buckets from file and refresh our bucketmap
+            // Copy buckets from file
             buckets = fileBuckets;
-            bucketMap.clear();
-            for (unsigned int i = 0; i < buckets.size(); i++) {
-                bucketMap[buckets[i]] = i;
-            }
 
-            // Destroy old TxConfirmStats and point to new ones that already reference buckets and bucketMap
+            // Destroy old TxConfirmStats and point to new ones that already reference buckets
             feeStats = std::move(fileFeeStats);
             shortStats = std::move(fileShortStats);
             longStats = std::move(fileLongStats);
+            if (fileHasMWEBStats) {
+                mwebFeeStats = std::move(fileMWEBFeeStats);
+                mwebShortStats = std::move(fileMWEBShortStats);
+                mwebLongStats = std::move(fileMWEBLongStats);
+            } else {
+                mwebFeeStats.reset(new TxConfirmStats(buckets, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
+                mwebShortStats.reset(new TxConfirmStats(buckets, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
+                mwebLongStats.reset(new TxConfirmStats(buckets, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
+            }
+            m_estimate_cache.clear();
 
             nBestSeenHeight = nFileBestSeenHeight;
             historicalFirst = nFileHistoricalFirst;
@@ -951,6 +1147,11 @@ void CBlockPolicyEstimator::FlushUnconfirmed() {
         auto mi = mapMemPoolTxs.begin();
         removeTx(mi->first, false); // this calls erase() on mapMemPoolTxs
     }
+    for (TxConfirmStats* stats : {feeStats.get(), shortStats.get(), longStats.get(),
+                                  mwebFeeStats.get(), mwebShortStats.get(), mwebLongStats.get()}) {
+        stats->ApplyPending();
+    }
+    m_estimate_cache.clear();
     int64_t endclear = GetTimeMicros();
     LogPrint(BCLog::ESTIMATEFEE, "Recorded %u unconfirmed txs from mempool in %gs\n", num_entries, (endclear - startclear)*0.000001);
 }
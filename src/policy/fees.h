@@ -11,9 +11,11 @@
 #include <random.h>
 #include <sync.h>
 
+#include <limits>
 #include <map>
 #include <memory>
 #include <string>
+#include <tuple>
 #include <vector>
 
 class CAutoFile;
@@ -22,6 +24,11 @@ class CTxMemPoolEntry;
 class CTxMemPool;
 class TxConfirmStats;
 
+namespace policyestimator_tests
+{
+    class TestEstimator;
+}
+
 /* Identifier for each of the 3 different TxConfirmStats which will track
  * history over different time horizons. */
 enum class FeeEstimateHorizon {
@@ -32,6 +39,14 @@ enum class FeeEstimateHorizon {
 
 std::string StringForFeeEstimateHorizon(FeeEstimateHorizon horizon);
 
+/* Block space that the feerates of a set of TxConfirmStats are paid for.
+ * MWEB transactions are limited by the MWEB weight of a block as well as by
+ * its size, so they are also tracked by the fee they pay per MWEB weight. */
+enum class FeeEstimateDimension {
+    VSIZE,       //!< Fee per 1000 virtual bytes
+    MWEB_WEIGHT, //!< Fee per 1000 units of MWEB weight, for MWEB transactions only
+};
+
 /* Enumeration of reason for returned fee estimate */
 enum class FeeReason {
     NONE,
@@ -120,9 +135,18 @@ struct FeeCalculation
  *  We want to be able to estimate feerates that are needed on tx's to be included in
  * a certain number of blocks.  Every time a block is added to the best chain, this class records
  * stats on the transactions included in that block
+ *
+ * Transactions with MWEB data are tracked a second time, in separate data sets
+ * grouped by their fee per MWEB weight, so that estimates for MWEB
+ * transactions reflect the demand for MWEB block space. Transactions without
+ * any virtual size (MWEB-to-MWEB ones) are only tracked by MWEB weight.
+ *
+ * The results of estimateSmartFee() are kept until the next block, as only
+ * blocks add data points to the moving averages.
  */
 class CBlockPolicyEstimator
 {
+friend class policyestimator_tests::TestEstimator; // for test access to the buckets and the estimate cache
 private:
     /** Track confirm delays up to 12 blocks for short horizon */
     static constexpr unsigned int SHORT_BLOCK_PERIODS = 12;
@@ -172,6 +196,9 @@ private:
      */
     static constexpr double FEE_SPACING = 1.05;
 
+    /** Bucket index of transactions that are not tracked in a dimension */
+    static constexpr unsigned int NO_BUCKET = std::numeric_limits<unsigned int>::max();
+
 public:
     /** Create new BlockPolicyEstimator and initialize stats tracking classes with default values */
     CBlockPolicyEstimator();
@@ -195,7 +222,8 @@ public:
      *  the closest target where one can be given.  'conservative' estimates are
      *  valid over longer time horizons also.
      */
-    CFeeRate estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative) const;
+    CFeeRate estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative,
+                              FeeEstimateDimension dimension = FeeEstimateDimension::VSIZE) const;
 
     /** Return a specific fee estimate calculation with a given success
      * threshold and time horizon, and optionally return detailed data about
@@ -227,7 +255,8 @@ private:
     {
         unsigned int blockHeight;
         unsigned int bucketIndex;
-        TxStatsInfo() : blockHeight(0), bucketIndex(0) {}
+        unsigned int mwebBucketIndex;
+        TxStatsInfo() : blockHeight(0), bucketIndex(NO_BUCKET), mwebBucketIndex(NO_BUCKET) {}
     };
 
     // map of txids to information about that transaction
@@ -237,20 +266,38 @@ private:
     std::unique_ptr<TxConfirmStats> feeStats PT_GUARDED_BY(m_cs_fee_estimator);
     std::unique_ptr<TxConfirmStats> shortStats PT_GUARDED_BY(m_cs_fee_estimator);
     std::unique_ptr<TxConfirmStats> longStats PT_GUARDED_BY(m_cs_fee_estimator);
+    /** Same for MWEB transactions, by fee per MWEB weight */
+    std::unique_ptr<TxConfirmStats> mwebFeeStats PT_GUARDED_BY(m_cs_fee_estimator);
+    std::unique_ptr<TxConfirmStats> mwebShortStats PT_GUARDED_BY(m_cs_fee_estimator);
+    std::unique_ptr<TxConfirmStats> mwebLongStats PT_GUARDED_BY(m_cs_fee_estimator);
 
     unsigned int trackedTxs GUARDED_BY(m_cs_fee_estimator);
     unsigned int untrackedTxs GUARDED_BY(m_cs_fee_estimator);
 
     std::vector<double> buckets GUARDED_BY(m_cs_fee_estimator); // The upper-bound of the range for the bucket (inclusive)
-    std::map<double, unsigned int> bucketMap GUARDED_BY(m_cs_fee_estimator); // Map of bucket upper-bound to index into all vectors by bucket
+
+    struct CachedEstimate
+    {
+        CFeeRate feeRate;
+        FeeCalculation feeCalc;
+    };
+    /** Results of estimateSmartFee() since the last block, by target, conservative and dimension */
+    mutable std::map<std::tuple<int, bool, FeeEstimateDimension>, CachedEstimate> m_estimate_cache GUARDED_BY(m_cs_fee_estimator);
 
     /** Process a transaction confirmed in a block*/
     bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
 
+    /** Index of the bucket a feerate falls into */
+    unsigned int GetBucketIndex(double feerate) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    /** The stats of a time horizon in a dimension */
+    TxConfirmStats& GetStats(FeeEstimateHorizon horizon, FeeEstimateDimension dimension) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+
+    /** Calculation of estimateSmartFee, whose results are cached */
+    CFeeRate calculateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative, FeeEstimateDimension dimension) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Helper for estimateSmartFee */
-    double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    double estimateCombinedFee(FeeEstimateDimension dimension, unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Helper for estimateSmartFee */
-    double estimateConservativeFee(unsigned int doubleTarget, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    double estimateConservativeFee(FeeEstimateDimension dimension, unsigned int doubleTarget, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Number of blocks of data recorded while fee estimates have been running */
     unsigned int BlockSpan() const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Number of blocks of recorded fee estimate data represented in saved data file */
@@ -181,6 +181,45 @@ bool XOnlyPubKey::VerifySchnorr(const uint256& msg, Span<const unsigned char> si
     return secp256k1_schnorrsig_verify(secp256k1_context_verify, sigbytes.data(), msg.begin(), &pubkey);
 }
 
+void SchnorrSignatureBatch::Add(Span<const unsigned char> sigbytes, const XOnlyPubKey& pubkey, const uint256& msg)
+{
+    assert(sigbytes.size() == 64);
+    m_sigs.insert(m_sigs.end(), sigbytes.begin(), sigbytes.end());
+    m_msgs.push_back(msg);
+    m_pubkeys.push_back(pubkey);
+    if (m_msgs.size() >= MAX_BATCH_SIZE) {
+        m_ok = VerifyPending() && m_ok;
+    }
+}
+
+bool SchnorrSignatureBatch::VerifyPending()
+{
+    bool ok = true;
+    for (size_t i = 0; ok && i < m_msgs.size(); ++i) {
+        ok = m_pubkeys[i].VerifySchnorr(m_msgs[i], MakeSpan(m_sigs).subspan(64 * i, 64));
+    }
+
+    m_sigs.clear();
+    m_msgs.clear();
+    m_pubkeys.clear();
+    return ok;
+}
+
+void SchnorrSignatureBatch::Clear()
+{
+    m_sigs.clear();
+    m_msgs.clear();
+    m_pubkeys.clear();
+    m_ok = true;
+}
+
+bool SchnorrSignatureBatch::Verify()
+{
+    const bool ok = VerifyPending() && m_ok;
+    m_ok = true;
+    return ok;
+}
+
 bool XOnlyPubKey::CheckPayToContract(const XOnlyPubKey& base, const uint256& hash, bool parity) const
 {
     secp256k1_xonly_pubkey base_point;
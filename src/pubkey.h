@@ -228,6 +228,44 @@ public:
     size_t size() const { return m_keydata.size(); }
 };
 
+/** Collects BIP340 Schnorr signatures to verify them together.
+ *
+ * The signatures are verified with the public libsecp256k1 API, one at a
+ * time, when the batch is verified. This lets callers defer verification
+ * until a set of checks is complete, and only tells whether all of the
+ * signatures are valid.
+ */
+class SchnorrSignatureBatch
+{
+private:
+    //! Signatures are verified early once this many are pending
+    static constexpr size_t MAX_BATCH_SIZE = 256;
+
+    std::vector<unsigned char> m_sigs;
+    std::vector<uint256> m_msgs;
+    std::vector<XOnlyPubKey> m_pubkeys;
+    //! Whether all signatures that were verified early were valid
+    bool m_ok{true};
+
+    bool VerifyPending();
+
+public:
+    SchnorrSignatureBatch() = default;
+    SchnorrSignatureBatch(const SchnorrSignatureBatch&) = delete;
+    SchnorrSignatureBatch& operator=(const SchnorrSignatureBatch&) = delete;
+
+    /** Add a signature to the batch. sigbytes must be exactly 64 bytes. */
+    void Add(Span<const unsigned char> sigbytes, const XOnlyPubKey& pubkey, const uint256& msg);
+
+    /** Verify all signatures added since the last call, and empty the batch. */
+    bool Verify();
+
+    /** Empty the batch without verifying it. */
+    void Clear();
+
+    size_t size() const { return m_msgs.size(); }
+};
+
 struct CExtPubKey {
     unsigned char nDepth;
     unsigned char vchFingerprint[4];
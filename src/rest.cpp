@@ -9,8 +9,10 @@
 #include <httpserver.h>
 #include <index/txindex.h>
 #include <node/context.h>
+#include <node/serializedblockcache.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
+#include <protocol.h>
 #include <rpc/blockchain.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
@@ -228,7 +230,67 @@ static bool rest_headers(const util::Ref& context,
     }
 }
 
-static bool rest_block(HTTPRequest* req,
+/** Serialize an object straight into a chunked HTTP reply, so that large
+ * objects are sent while they are being serialized instead of first being
+ * copied into a buffer of their full size.
+ */
+class ChunkedReplyStream
+{
+    HTTPRequest* const m_req;
+    const int m_type;
+    const int m_version;
+    const bool m_hex;
+    std::vector<unsigned char> m_buffer;
+
+    void Flush()
+    {
+        if (m_buffer.empty()) return;
+        m_req->WriteReplyChunk(m_hex ? HexStr(m_buffer) : std::string(m_buffer.begin(), m_buffer.end()));
+        m_buffer.clear();
+    }
+
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    ChunkedReplyStream(HTTPRequest* req, int type, int version, bool hex)
+        : m_req(req), m_type(type), m_version(version), m_hex(hex)
+    {
+        m_buffer.reserve(CHUNK_SIZE);
+        m_req->StartChunkedReply(HTTP_OK);
+    }
+
+    void write(const char* pch, size_t size)
+    {
+        while (size > 0) {
+            const size_t n = std::min(size, CHUNK_SIZE - m_buffer.size());
+            m_buffer.insert(m_buffer.end(), pch, pch + n);
+            pch += n;
+            size -= n;
+            if (m_buffer.size() == CHUNK_SIZE) Flush();
+        }
+    }
+
+    template <typename T>
+    ChunkedReplyStream& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+
+    /** Send the remaining data, followed by trailer, and complete the reply */
+    void Finish(const std::string& trailer = "")
+    {
+        Flush();
+        m_req->WriteReplyChunk(trailer);
+        m_req->EndChunkedReply();
+    }
+
+    int GetType() const { return m_type; }
+    int GetVersion() const { return m_version; }
+};
+
+static bool rest_block(const util::Ref& context,
+                       HTTPRequest* req,
                        const std::string& strURIPart,
                        bool showTxDetails)
 {
@@ -241,7 +303,11 @@ static bool rest_block(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
+    const int ser_version = PROTOCOL_VERSION | RPCSerializationFlags();
+    SerializedBlockCache* const block_cache = context.Has<NodeContext>() ? context.Get<NodeContext>().block_cache.get() : nullptr;
+
     CBlock block;
+    SharedNetMsgPayloadRef payload;
     CBlockIndex* pblockindex = nullptr;
     CBlockIndex* tip = nullptr;
     {
@@ -255,26 +321,44 @@ static bool rest_block(HTTPRequest* req,
         if (IsBlockPruned(pblockindex))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        // The serialized formats may be served from the cache of blocks recently sent to peers
+        if (rf != RetFormat::JSON && block_cache) {
+            payload = block_cache->Get(hash, NetMsgType::BLOCK, ser_version);
+        }
+
+        if (!payload && !ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
+    if (rf != RetFormat::JSON && block_cache && !payload) {
+        std::vector<unsigned char> data;
+        CVectorWriter{SER_NETWORK, ser_version, data, 0, block};
+        payload = std::make_shared<const CSharedNetMsgPayload>(std::move(data));
+        block_cache->Add(hash, NetMsgType::BLOCK, ser_version, payload);
+    }
+
     switch (rf) {
     case RetFormat::BINARY: {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string binaryBlock = ssBlock.str();
         req->WriteHeader("Content-Type", "application/octet-stream");
-        req->WriteReply(HTTP_OK, binaryBlock);
+        ChunkedReplyStream ssBlock(req, SER_NETWORK, ser_version, false);
+        if (payload) {
+            ssBlock.write(reinterpret_cast<const char*>(payload->Data().data()), payload->Data().size());
+        } else {
+            ssBlock << block;
+        }
+        ssBlock.Finish();
         return true;
     }
 
     case RetFormat::HEX: {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
-        req->WriteReply(HTTP_OK, strHex);
+        ChunkedReplyStream ssBlock(req, SER_NETWORK, ser_version, true);
+        if (payload) {
+            ssBlock.write(reinterpret_cast<const char*>(payload->Data().data()), payload->Data().size());
+        } else {
+            ssBlock << block;
+        }
+        ssBlock.Finish("\n");
         return true;
     }
 
@@ -294,12 +378,12 @@ static bool rest_block(HTTPRequest* req,
 
 static bool rest_block_extended(const util::Ref& context, HTTPRequest* req, const std::string& strURIPart)
 {
-    return rest_block(req, strURIPart, true);
+    return rest_block(context, req, strURIPart, true);
 }
 
 static bool rest_block_notxdetails(const util::Ref& context, HTTPRequest* req, const std::string& strURIPart)
 {
-    return rest_block(req, strURIPart, false);
+    return rest_block(context, req, strURIPart, false);
 }
 
 // A bit of a hack - dependency on a function defined in rpc/blockchain.cpp
@@ -669,23 +753,28 @@ static bool rest_blockhash_by_height(const util::Ref& context, HTTPRequest* req,
 static const struct {
     const char* prefix;
     bool (*handler)(const util::Ref& context, HTTPRequest* req, const std::string& strReq);
+    bool expensive; //!< handled by the expensive request workers, if enabled
 } uri_prefixes[] = {
-      {"/rest/tx/", rest_tx},
-      {"/rest/block/notxdetails/", rest_block_notxdetails},
-      {"/rest/block/", rest_block_extended},
-      {"/rest/chaininfo", rest_chaininfo},
-      {"/rest/mempool/info", rest_mempool_info},
-      {"/rest/mempool/contents", rest_mempool_contents},
-      {"/rest/headers/", rest_headers},
-      {"/rest/getutxos", rest_getutxos},
-      {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/tx/", rest_tx, false},
+      {"/rest/block/notxdetails/", rest_block_notxdetails, true},
+      {"/rest/block/", rest_block_extended, true},
+      {"/rest/chaininfo", rest_chaininfo, false},
+      {"/rest/mempool/info", rest_mempool_info, false},
+      {"/rest/mempool/contents", rest_mempool_contents, true},
+      {"/rest/headers/", rest_headers, false},
+      {"/rest/getutxos", rest_getutxos, true},
+      {"/rest/blockhashbyheight/", rest_blockhash_by_height, false},
 };
 
 void StartREST(const util::Ref& context)
 {
     for (const auto& up : uri_prefixes) {
         auto handler = [&context, up](HTTPRequest* req, const std::string& prefix) { return up.handler(context, req, prefix); };
-        RegisterHTTPHandler(up.prefix, false, handler);
+        HTTPRequestClassifier is_expensive;
+        if (up.expensive) {
+            is_expensive = [](const HTTPRequest*, const std::string&) { return true; };
+        }
+        RegisterHTTPHandler(up.prefix, false, handler, is_expensive);
     }
 }
 
@@ -12,8 +12,10 @@
 #include <coins.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <dbwrapper.h>
 #include <hash.h>
 #include <index/blockfilterindex.h>
+#include <node/blockimport.h>
 #include <node/coinstats.h>
 #include <node/context.h>
 #include <node/utxo_snapshot.h>
@@ -21,9 +23,11 @@
 #include <policy/policy.h>
 #include <policy/rbf.h>
 #include <primitives/transaction.h>
+#include <rpc/jsonstream.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
+#include <script/sigcache.h>
 #include <streams.h>
 #include <sync.h>
 #include <txdb.h>
@@ -172,15 +176,84 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
+static UniValue blockTxToJSON(const CTransaction& tx, bool txDetails)
 {
-    // Serialize passed information without accessing chain state of the active chain!
-    AssertLockNotHeld(cs_main); // For performance reasons
+    if (!txDetails) return tx.GetHash().GetHex();
+    UniValue objTx(UniValue::VOBJ);
+    TxToUniv(tx, uint256(), objTx, true, RPCSerializationFlags());
+    return objTx;
+}
+
+static UniValue mwebHeaderToJSON(const mw::Header& header)
+{
+    UniValue mweb_header(UniValue::VOBJ);
+    mweb_header.pushKV("hash", header.GetHash().ToHex());
+    mweb_header.pushKV("height", header.GetHeight());
+    mweb_header.pushKV("kernel_offset", header.GetKernelOffset().ToHex());
+    mweb_header.pushKV("stealth_offset", header.GetStealthOffset().ToHex());
+    mweb_header.pushKV("num_kernels", header.GetNumKernels());
+    mweb_header.pushKV("num_txos", header.GetNumTXOs());
+    mweb_header.pushKV("kernel_root", header.GetKernelRoot().ToHex());
+    mweb_header.pushKV("output_root", header.GetOutputRoot().ToHex());
+    mweb_header.pushKV("leaf_root", header.GetLeafsetRoot().ToHex());
+    return mweb_header;
+}
+
+static UniValue mwebInputToJSON(const Input& input, bool txDetails)
+{
+    if (!txDetails) return input.GetOutputID().ToHex();
+    UniValue objInput(UniValue::VOBJ);
+    objInput.pushKV("output_id", input.GetOutputID().ToHex());
+    objInput.pushKV("commit", input.GetCommitment().ToHex());
+    objInput.pushKV("output_pubkey", input.GetOutputPubKey().ToHex());
+
+    if (!!input.GetInputPubKey()) {
+        objInput.pushKV("input_pubkey", input.GetInputPubKey()->ToHex());
+    }
+
+    if (!input.GetExtraData().empty()) {
+        objInput.pushKV("extra_data", HexStr(input.GetExtraData()));
+    }
+
+    objInput.pushKV("sig", input.GetSignature().ToHex());
+    return objInput;
+}
 
+static UniValue mwebOutputToJSON(const Output& output, bool txDetails)
+{
+    if (!txDetails) return output.GetOutputID().ToHex();
+    UniValue objOutput(UniValue::VOBJ);
+    objOutput.pushKV("output_id", output.GetOutputID().ToHex());
+    objOutput.pushKV("commit", output.GetCommitment().ToHex());
+    objOutput.pushKV("sender_pubkey", output.GetSenderPubKey().ToHex());
+    objOutput.pushKV("receiver_pubkey", output.GetReceiverPubKey().ToHex());
+    objOutput.pushKV("range_proof", HexStr(output.GetRangeProof()->Serialized()));
+    objOutput.pushKV("message", HexStr(output.GetOutputMessage().Serialized()));
+    return objOutput;
+}
+
+static UniValue mwebKernelToJSON(const Kernel& kernel, bool txDetails)
+{
+    if (!txDetails) return kernel.GetCommitment().ToHex();
+    UniValue objKernel(UniValue::VOBJ);
+    objKernel.pushKV("kernel_id", kernel.GetKernelID().ToHex());
+    objKernel.pushKV("features", kernel.GetFeatures());
+    objKernel.pushKV("commit", kernel.GetCommitment().ToHex());
+    objKernel.pushKV("fee", kernel.GetFee());
+    objKernel.pushKV("lock_height", kernel.GetLockHeight());
+    objKernel.pushKV("excess", kernel.GetExcess().ToHex());
+    objKernel.pushKV("signature", kernel.GetSignature().ToHex());
+    if (!kernel.GetExtraData().empty()) {
+        objKernel.pushKV("extra_data", HexStr(kernel.GetExtraData()));
+    }
+    return objKernel;
+}
+
+/** The block fields written before the "tx" array */
+static UniValue blockFieldsToJSON(const CBlock& block, const CBlockIndex* blockindex, int confirmations)
+{
     UniValue result(UniValue::VOBJ);
     result.pushKV("hash", blockindex->GetBlockHash().GetHex());
-    const CBlockIndex* pnext;
-    int confirmations = ComputeNextBlockAndDepth(tip, blockindex, pnext);
     result.pushKV("confirmations", confirmations);
     result.pushKV("strippedsize", (int)::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS | SERIALIZE_NO_MWEB));
     result.pushKV("size", (int)::GetSerializeSize(block, PROTOCOL_VERSION));
@@ -189,19 +262,13 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
     result.pushKV("version", block.nVersion);
     result.pushKV("versionHex", strprintf("%08x", block.nVersion));
     result.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
-    UniValue txs(UniValue::VARR);
-    for(const auto& tx : block.vtx)
-    {
-        if(txDetails)
-        {
-            UniValue objTx(UniValue::VOBJ);
-            TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags());
-            txs.push_back(objTx);
-        }
-        else
-            txs.push_back(tx->GetHash().GetHex());
-    }
-    result.pushKV("tx", txs);
+    return result;
+}
+
+/** The block fields written between the "tx" array and the "mweb" object */
+static UniValue blockTrailerToJSON(const CBlock& block, const CBlockIndex* blockindex)
+{
+    UniValue result(UniValue::VOBJ);
     result.pushKV("time", block.GetBlockTime());
     result.pushKV("mediantime", (int64_t)blockindex->GetMedianTimePast());
     result.pushKV("nonce", (uint64_t)block.nNonce);
@@ -209,83 +276,42 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
     result.pushKV("difficulty", GetDifficulty(blockindex));
     result.pushKV("chainwork", blockindex->nChainWork.GetHex());
     result.pushKV("nTx", (uint64_t)blockindex->nTx);
+    return result;
+}
+
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
+{
+    // Serialize passed information without accessing chain state of the active chain!
+    AssertLockNotHeld(cs_main); // For performance reasons
+
+    const CBlockIndex* pnext;
+    int confirmations = ComputeNextBlockAndDepth(tip, blockindex, pnext);
+    UniValue result = blockFieldsToJSON(block, blockindex, confirmations);
+    UniValue txs(UniValue::VARR);
+    for (const auto& tx : block.vtx) {
+        txs.push_back(blockTxToJSON(*tx, txDetails));
+    }
+    result.pushKV("tx", txs);
+    result.pushKVs(blockTrailerToJSON(block, blockindex));
 
     if (!block.mweb_block.IsNull()) {
-        UniValue mweb_block(UniValue::VOBJ);
-
-        // MWEB Header
-        mweb_block.pushKV("hash", block.mweb_block.GetMWEBHeader()->GetHash().ToHex());
-        mweb_block.pushKV("height", block.mweb_block.GetMWEBHeader()->GetHeight());
-        mweb_block.pushKV("kernel_offset", block.mweb_block.GetMWEBHeader()->GetKernelOffset().ToHex());
-        mweb_block.pushKV("stealth_offset", block.mweb_block.GetMWEBHeader()->GetStealthOffset().ToHex());
-        mweb_block.pushKV("num_kernels", block.mweb_block.GetMWEBHeader()->GetNumKernels());
-        mweb_block.pushKV("num_txos", block.mweb_block.GetMWEBHeader()->GetNumTXOs());
-        mweb_block.pushKV("kernel_root", block.mweb_block.GetMWEBHeader()->GetKernelRoot().ToHex());
-        mweb_block.pushKV("output_root", block.mweb_block.GetMWEBHeader()->GetOutputRoot().ToHex());
-        mweb_block.pushKV("leaf_root", block.mweb_block.GetMWEBHeader()->GetLeafsetRoot().ToHex());
-
-        // MWEB Inputs
+        UniValue mweb_block = mwebHeaderToJSON(*block.mweb_block.GetMWEBHeader());
+
         UniValue inputs(UniValue::VARR);
         for (const auto& input : block.mweb_block.m_block->GetInputs()) {
-            if (txDetails) {
-                UniValue objInput(UniValue::VOBJ);
-                objInput.pushKV("output_id", input.GetOutputID().ToHex());
-                objInput.pushKV("commit", input.GetCommitment().ToHex());
-                objInput.pushKV("output_pubkey", input.GetOutputPubKey().ToHex());
-
-                if (!!input.GetInputPubKey()) {
-                    objInput.pushKV("input_pubkey", input.GetInputPubKey()->ToHex());
-                }
-
-                if (!input.GetExtraData().empty()) {
-                    objInput.pushKV("extra_data", HexStr(input.GetExtraData()));
-                }
-
-                objInput.pushKV("sig", input.GetSignature().ToHex());
-                inputs.push_back(objInput);
-            } else {
-                inputs.push_back(input.GetOutputID().ToHex());
-            }
+            inputs.push_back(mwebInputToJSON(input, txDetails));
         }
         mweb_block.pushKV("inputs", inputs);
 
-        // MWEB Outputs
         UniValue outputs(UniValue::VARR);
         for (const auto& output : block.mweb_block.m_block->GetOutputs()) {
-            if (txDetails) {
-                UniValue objOutput(UniValue::VOBJ);
-                objOutput.pushKV("output_id", output.GetOutputID().ToHex());
-                objOutput.pushKV("commit", output.GetCommitment().ToHex());
-                objOutput.pushKV("sender_pubkey", output.GetSenderPubKey().ToHex());
-                objOutput.pushKV("receiver_pubkey", output.GetReceiverPubKey().ToHex());
-                objOutput.pushKV("range_proof", HexStr(output.GetRangeProof()->Serialized()));
-                objOutput.pushKV("message", HexStr(output.GetOutputMessage().Serialized()));
-                outputs.push_back(objOutput);
-            } else {
-                outputs.push_back(output.GetOutputID().ToHex());
-            }
+            outputs.push_back(mwebOutputToJSON(output, txDetails));
         }
         mweb_block.pushKV("outputs", outputs);
 
-        // MWEB Kernels
         UniValue kernels(UniValue::VARR);
         for (const auto& kernel : block.mweb_block.m_block->GetKernels()) {
-            if (txDetails) {
-                UniValue objKernel(UniValue::VOBJ);
-                objKernel.pushKV("kernel_id", kernel.GetKernelID().ToHex());
-                objKernel.pushKV("features", kernel.GetFeatures());
-                objKernel.pushKV("commit", kernel.GetCommitment().ToHex());
-                objKernel.pushKV("fee", kernel.GetFee());
-                objKernel.pushKV("lock_height", kernel.GetLockHeight());
-                objKernel.pushKV("excess", kernel.GetExcess().ToHex());
-                objKernel.pushKV("signature", kernel.GetSignature().ToHex());
-                if (!kernel.GetExtraData().empty()) {
-                    objKernel.pushKV("extra_data", HexStr(kernel.GetExtraData()));
-                }
-                kernels.push_back(objKernel);
-            } else {
-                kernels.push_back(kernel.GetCommitment().ToHex());
-            }
+            kernels.push_back(mwebKernelToJSON(kernel, txDetails));
         }
         mweb_block.pushKV("kernels", kernels);
 
@@ -299,6 +325,58 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
     return result;
 }
 
+void blockToJSON(JSONStreamWriter& writer, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
+{
+    AssertLockNotHeld(cs_main);
+
+    const CBlockIndex* pnext;
+    int confirmations = ComputeNextBlockAndDepth(tip, blockindex, pnext);
+    writer.BeginObject();
+    writer.Members(blockFieldsToJSON(block, blockindex, confirmations));
+    writer.Key("tx");
+    writer.BeginArray();
+    for (const auto& tx : block.vtx) {
+        writer.Value(blockTxToJSON(*tx, txDetails));
+    }
+    writer.EndArray();
+    writer.Members(blockTrailerToJSON(block, blockindex));
+
+    if (!block.mweb_block.IsNull()) {
+        writer.Key("mweb");
+        writer.BeginObject();
+        writer.Members(mwebHeaderToJSON(*block.mweb_block.GetMWEBHeader()));
+
+        writer.Key("inputs");
+        writer.BeginArray();
+        for (const auto& input : block.mweb_block.m_block->GetInputs()) {
+            writer.Value(mwebInputToJSON(input, txDetails));
+        }
+        writer.EndArray();
+
+        writer.Key("outputs");
+        writer.BeginArray();
+        for (const auto& output : block.mweb_block.m_block->GetOutputs()) {
+            writer.Value(mwebOutputToJSON(output, txDetails));
+        }
+        writer.EndArray();
+
+        writer.Key("kernels");
+        writer.BeginArray();
+        for (const auto& kernel : block.mweb_block.m_block->GetKernels()) {
+            writer.Value(mwebKernelToJSON(kernel, txDetails));
+        }
+        writer.EndArray();
+
+        writer.EndObject();
+    }
+
+    if (blockindex->pprev)
+        writer.KeyValue("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
+    if (pnext)
+        writer.KeyValue("nextblockhash", pnext->GetBlockHash().GetHex());
+    writer.EndObject();
+}
+
 static RPCHelpMan getblockcount()
 {
     return RPCHelpMan{"getblockcount",
@@ -717,6 +795,51 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempoo
     }
 }
 
+void MempoolToJSON(JSONStreamWriter& writer, const CTxMemPool& pool, bool verbose, bool include_mempool_sequence)
+{
+    if (!verbose) {
+        // The txid list is small compared to the verbose output
+        writer.Value(MempoolToJSON(pool, verbose, include_mempool_sequence));
+        return;
+    }
+    if (include_mempool_sequence) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbose results cannot contain mempool sequence values.");
+    }
+    AssertLockNotHeld(pool.cs);
+    // Writing to the stream may block until the client reads the reply, so
+    // the entries are built in batches under the mempool lock and only
+    // written after it is released. Transactions that leave the mempool
+    // between batches are skipped.
+    static constexpr size_t BATCH_SIZE = 1000;
+    std::vector<uint256> txids;
+    {
+        LOCK(pool.cs);
+        txids.reserve(pool.mapTx.size());
+        for (const CTxMemPoolEntry& e : pool.mapTx) {
+            txids.push_back(e.GetTx().GetHash());
+        }
+    }
+    writer.BeginObject();
+    std::vector<std::pair<std::string, UniValue>> batch;
+    for (size_t i = 0; i < txids.size();) {
+        {
+            LOCK(pool.cs);
+            for (; i < txids.size() && batch.size() < BATCH_SIZE; ++i) {
+                const auto it = pool.mapTx.find(txids[i]);
+                if (it == pool.mapTx.end()) continue;
+                UniValue info(UniValue::VOBJ);
+                entryToJSON(pool, info, *it);
+                batch.emplace_back(txids[i].ToString(), std::move(info));
+            }
+        }
+        for (const auto& entry : batch) {
+            writer.KeyValue(entry.first, entry.second);
+        }
+        batch.clear();
+    }
+    writer.EndObject();
+}
+
 static RPCHelpMan getrawmempool()
 {
     return RPCHelpMan{"getrawmempool",
@@ -762,6 +885,10 @@ static RPCHelpMan getrawmempool()
         include_mempool_sequence = request.params[1].get_bool();
     }
 
+    if (request.stream) {
+        MempoolToJSON(*request.stream, EnsureMemPool(request.context), fVerbose, include_mempool_sequence);
+        return NullUniValue;
+    }
     return MempoolToJSON(EnsureMemPool(request.context), fVerbose, include_mempool_sequence);
 },
     };
@@ -1145,6 +1272,10 @@ static RPCHelpMan getblock()
         return strHex;
     }
 
+    if (request.stream) {
+        blockToJSON(*request.stream, block, tip, pblockindex, verbosity >= 2);
+        return NullUniValue;
+    }
     return blockToJSON(block, tip, pblockindex, verbosity >= 2);
 },
     };
@@ -1261,6 +1392,199 @@ static RPCHelpMan gettxoutsetinfo()
     };
 }
 
+static UniValue CoinsFlushStatsToJSON(const CoinsFlushStats& stats)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("flushes", stats.flushes);
+    ret.pushKV("entries", stats.entries);
+    ret.pushKV("changed", stats.changed);
+    ret.pushKV("bytes", stats.bytes);
+    ret.pushKV("total_ms", stats.total_time * 0.001);
+    ret.pushKV("serialize_ms", stats.serialize_time * 0.001);
+    ret.pushKV("write_ms", stats.write_time * 0.001);
+    ret.pushKV("mweb_ms", stats.mweb_time * 0.001);
+    return ret;
+}
+
+static RPCHelpMan getcoinsflushinfo()
+{
+    const std::vector<RPCResult> flush_fields{
+        {RPCResult::Type::NUM, "flushes", "The number of flushes"},
+        {RPCResult::Type::NUM, "entries", "The number of cache entries walked"},
+        {RPCResult::Type::NUM, "changed", "The number of dirty coins written or erased"},
+        {RPCResult::Type::NUM, "bytes", "The estimated size of the written batches"},
+        {RPCResult::Type::NUM, "total_ms", "The time spent flushing, in milliseconds"},
+        {RPCResult::Type::NUM, "serialize_ms", "The time spent serializing coins, summed over all flush threads"},
+        {RPCResult::Type::NUM, "write_ms", "The time spent writing to the database, overlapped with serializing"},
+        {RPCResult::Type::NUM, "mweb_ms", "The time spent flushing MWEB state, overlapped with serializing and writing coins"},
+    };
+    return RPCHelpMan{"getcoinsflushinfo",
+                "\nReturns durations and sizes of flushes of the coins cache to the chainstate database.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "last", "The most recent flush", flush_fields},
+                        {RPCResult::Type::OBJ, "total", "Totals over all flushes since startup", flush_fields},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getcoinsflushinfo", "")
+            + HelpExampleRpc("getcoinsflushinfo", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    CoinsFlushStats last, total;
+    WITH_LOCK(::cs_main, ::ChainstateActive().CoinsDB().GetFlushStats(last, total));
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("last", CoinsFlushStatsToJSON(last));
+    ret.pushKV("total", CoinsFlushStatsToJSON(total));
+    return ret;
+},
+    };
+}
+
+static RPCHelpMan getdbstats()
+{
+    return RPCHelpMan{"getdbstats",
+                "\nReturns read, write and compaction statistics of the open LevelDB databases.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::ARR, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::STR, "name", "The database name, as used by -dbtuning"},
+                            {RPCResult::Type::NUM, "reads", "The number of point lookups"},
+                            {RPCResult::Type::NUM, "read_misses", "The number of point lookups that found nothing"},
+                            {RPCResult::Type::NUM, "read_bytes", "The size of the values read"},
+                            {RPCResult::Type::NUM, "batches", "The number of batches written"},
+                            {RPCResult::Type::NUM, "write_bytes", "The estimated size of the batches written"},
+                            {RPCResult::Type::NUM, "memory_usage", "The estimated memory usage of the database, in bytes"},
+                            {RPCResult::Type::NUM, "block_cache_usage", "The memory used by the block cache, in bytes"},
+                            {RPCResult::Type::BOOL, "shared_block_cache", "Whether the block cache is shared with the other databases"},
+                            {RPCResult::Type::OBJ, "tuning", "The tuning the database was opened with",
+                            {
+                                {RPCResult::Type::STR, "compression", "The block compression (none or snappy)"},
+                                {RPCResult::Type::NUM, "block_size", "The table block size, in bytes"},
+                                {RPCResult::Type::NUM, "bloom_bits", "The bloom filter bits per key"},
+                                {RPCResult::Type::NUM, "max_open_files", "The maximum number of open files (0 = LevelDB default)"},
+                            }},
+                            {RPCResult::Type::ARR, "levels", "The levels with files or compactions",
+                            {
+                                {RPCResult::Type::OBJ, "", "",
+                                {
+                                    {RPCResult::Type::NUM, "level", "The level"},
+                                    {RPCResult::Type::NUM, "files", "The number of table files"},
+                                    {RPCResult::Type::NUM, "size_mb", "The size of the table files, in MB"},
+                                    {RPCResult::Type::NUM, "compaction_sec", "The time spent compacting into this level, in seconds"},
+                                    {RPCResult::Type::NUM, "compaction_read_mb", "The data read by those compactions, in MB"},
+                                    {RPCResult::Type::NUM, "compaction_write_mb", "The data written by those compactions, in MB"},
+                                }},
+                            }},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    UniValue ret(UniValue::VARR);
+    for (const DBStats& stats : GetAllDBStats()) {
+        UniValue db(UniValue::VOBJ);
+        db.pushKV("name", stats.name);
+        db.pushKV("reads", stats.reads);
+        db.pushKV("read_misses", stats.read_misses);
+        db.pushKV("read_bytes", stats.read_bytes);
+        db.pushKV("batches", stats.batches);
+        db.pushKV("write_bytes", stats.write_bytes);
+        db.pushKV("memory_usage", (uint64_t)stats.memory_usage);
+        db.pushKV("block_cache_usage", (uint64_t)stats.block_cache_usage);
+        db.pushKV("shared_block_cache", stats.shared_block_cache);
+        UniValue tuning(UniValue::VOBJ);
+        tuning.pushKV("compression", stats.tuning.compression == leveldb::kSnappyCompression ? "snappy" : "none");
+        tuning.pushKV("block_size", (uint64_t)stats.tuning.block_size);
+        tuning.pushKV("bloom_bits", stats.tuning.bloom_bits);
+        tuning.pushKV("max_open_files", stats.tuning.max_open_files);
+        db.pushKV("tuning", tuning);
+        UniValue levels(UniValue::VARR);
+        for (const DBLevelStats& level_stats : stats.levels) {
+            UniValue level(UniValue::VOBJ);
+            level.pushKV("level", level_stats.level);
+            level.pushKV("files", level_stats.files);
+            level.pushKV("size_mb", level_stats.size_mb);
+            level.pushKV("compaction_sec", level_stats.compaction_sec);
+            level.pushKV("compaction_read_mb", level_stats.compaction_read_mb);
+            level.pushKV("compaction_write_mb", level_stats.compaction_write_mb);
+            levels.push_back(level);
+        }
+        db.pushKV("levels", levels);
+        ret.push_back(db);
+    }
+    return ret;
+},
+    };
+}
+
+static RPCHelpMan getsigcachestats()
+{
+    return RPCHelpMan{"getsigcachestats",
+                "\nReturns lookup and insert counts of the signature cache, in total and per shard.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "hits", "The number of lookups that found their signature"},
+                        {RPCResult::Type::NUM, "misses", "The number of lookups that did not"},
+                        {RPCResult::Type::NUM, "inserts", "The number of signatures added"},
+                        {RPCResult::Type::NUM, "elements", "The number of signatures the cache can hold"},
+                        {RPCResult::Type::NUM, "hit_rate", "The share of lookups that were hits"},
+                        {RPCResult::Type::ARR, "shards", "",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::NUM, "hits", "The number of lookups in this shard that found their signature"},
+                                {RPCResult::Type::NUM, "misses", "The number of lookups in this shard that did not"},
+                                {RPCResult::Type::NUM, "inserts", "The number of signatures added to this shard"},
+                                {RPCResult::Type::NUM, "elements", "The number of signatures this shard can hold"},
+                            }},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getsigcachestats", "")
+            + HelpExampleRpc("getsigcachestats", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    SignatureCacheShardStats total;
+    UniValue shards(UniValue::VARR);
+    for (const SignatureCacheShardStats& stats : GetSignatureCacheStats()) {
+        UniValue shard(UniValue::VOBJ);
+        shard.pushKV("hits", stats.hits);
+        shard.pushKV("misses", stats.misses);
+        shard.pushKV("inserts", stats.inserts);
+        shard.pushKV("elements", (uint64_t)stats.elements);
+        shards.push_back(shard);
+        total.hits += stats.hits;
+        total.misses += stats.misses;
+        total.inserts += stats.inserts;
+        total.elements += stats.elements;
+    }
+    const uint64_t lookups = total.hits + total.misses;
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("hits", total.hits);
+    ret.pushKV("misses", total.misses);
+    ret.pushKV("inserts", total.inserts);
+    ret.pushKV("elements", (uint64_t)total.elements);
+    ret.pushKV("hit_rate", lookups ? double(total.hits) / lookups : 0.0);
+    ret.pushKV("shards", shards);
+    return ret;
+},
+    };
+}
+
 static RPCHelpMan gettxout()
 {
     return RPCHelpMan{"gettxout",
@@ -1489,6 +1813,30 @@ RPCHelpMan getblockchaininfo()
                                 {RPCResult::Type::BOOL, "active", "true if the rules are enforced for the mempool and the next block"},
                             }},
                         }},
+                        {RPCResult::Type::OBJ, "inputprefetch", "lookups of the inputs of the next block while a block is connected (only present if -prefetchinputs is enabled)",
+                        {
+                            {RPCResult::Type::NUM, "threads", "the number of prefetch threads"},
+                            {RPCResult::Type::NUM, "blocks", "the number of blocks connected after their inputs were prefetched"},
+                            {RPCResult::Type::NUM, "inputs", "the number of inputs of those blocks, not counting spends of outputs created in the same block"},
+                            {RPCResult::Type::NUM, "warmed", "the number of coins read from disk and added to the coins cache"},
+                            {RPCResult::Type::NUM, "cached", "the number of coins read from disk that were already in the coins cache"},
+                            {RPCResult::Type::NUM, "missing", "the number of coins not on disk, as they were created after the last flush"},
+                            {RPCResult::Type::NUM, "discarded", "the number of lookups thrown away because the coins database was written meanwhile"},
+                            {RPCResult::Type::NUM, "mweb_inputs", "the number of MWEB inputs whose UTXOs were read ahead of time"},
+                            {RPCResult::Type::NUM, "hit_rate", "the fraction of inputs that were added to the coins cache by the prefetch"},
+                        }},
+                        {RPCResult::Type::OBJ, "import", "progress of the running or last -reindex or -loadblock import (only present after one started)",
+                        {
+                            {RPCResult::Type::BOOL, "active", "whether the import is running"},
+                            {RPCResult::Type::NUM, "files", "the number of block files to import"},
+                            {RPCResult::Type::NUM, "files_done", "the number of block files fully processed"},
+                            {RPCResult::Type::NUM, "blocks_read", "the number of blocks read from the files"},
+                            {RPCResult::Type::NUM, "bytes_read", "the serialized size of those blocks"},
+                            {RPCResult::Type::NUM, "blocks_loaded", "the number of blocks added to the block index"},
+                            {RPCResult::Type::NUM, "elapsed", "the time spent importing, in seconds"},
+                            {RPCResult::Type::NUM, "blocks_per_second", "the number of blocks read per second"},
+                            {RPCResult::Type::NUM, "mib_per_second", "the MiB of blocks read per second"},
+                        }},
                         {RPCResult::Type::STR, "warnings", "any network and blockchain warnings"},
                     }},
                 RPCExamples{
@@ -1541,6 +1889,37 @@ RPCHelpMan getblockchaininfo()
     VBSoftForkDescPushBack(softforks, "mweb", consensusParams, Consensus::DEPLOYMENT_MWEB);
     obj.pushKV("softforks",             softforks);
 
+    if (const InputPrefetcher* prefetcher = ::ChainstateActive().GetInputPrefetcher()) {
+        const InputPrefetchStats stats = prefetcher->GetStats();
+        UniValue prefetch(UniValue::VOBJ);
+        prefetch.pushKV("threads", prefetcher->NumThreads());
+        prefetch.pushKV("blocks", stats.blocks);
+        prefetch.pushKV("inputs", stats.inputs);
+        prefetch.pushKV("warmed", stats.warmed);
+        prefetch.pushKV("cached", stats.cached);
+        prefetch.pushKV("missing", stats.missing);
+        prefetch.pushKV("discarded", stats.discarded);
+        prefetch.pushKV("mweb_inputs", stats.mweb_inputs);
+        prefetch.pushKV("hit_rate", stats.inputs ? double(stats.warmed) / stats.inputs : 0.0);
+        obj.pushKV("inputprefetch", prefetch);
+    }
+
+    const BlockImportStats import_stats = GetBlockImportStats();
+    if (import_stats.files > 0) {
+        const double elapsed = import_stats.elapsed_ms / 1000.0;
+        UniValue import(UniValue::VOBJ);
+        import.pushKV("active", import_stats.active);
+        import.pushKV("files", import_stats.files);
+        import.pushKV("files_done", import_stats.files_done);
+        import.pushKV("blocks_read", import_stats.blocks_read);
+        import.pushKV("bytes_read", import_stats.bytes_read);
+        import.pushKV("blocks_loaded", import_stats.blocks_loaded);
+        import.pushKV("elapsed", elapsed);
+        import.pushKV("blocks_per_second", elapsed > 0 ? import_stats.blocks_read / elapsed : 0.0);
+        import.pushKV("mib_per_second", elapsed > 0 ? import_stats.bytes_read / elapsed / (1024 * 1024) : 0.0);
+        obj.pushKV("import", import);
+    }
+
     obj.pushKV("warnings", GetWarnings(false).original);
     return obj;
 },
@@ -2545,7 +2924,7 @@ static RPCHelpMan dumptxoutset()
 {
     return RPCHelpMan{
         "dumptxoutset",
-        "\nWrite the serialized UTXO set to disk.\n",
+        "\nWrite the serialized UTXO set to disk, including the MWEB UTXOs, leafset and kernels.\n",
         {
             {"path",
                 RPCArg::Type::STR,
@@ -2557,6 +2936,8 @@ static RPCHelpMan dumptxoutset()
             RPCResult::Type::OBJ, "", "",
                 {
                     {RPCResult::Type::NUM, "coins_written", "the number of coins written in the snapshot"},
+                    {RPCResult::Type::NUM, "mweb_utxos_written", "the number of MWEB UTXOs written in the snapshot"},
+                    {RPCResult::Type::NUM, "mweb_kernels_written", "the number of MWEB kernels written in the snapshot"},
                     {RPCResult::Type::STR_HEX, "base_hash", "the hash of the base of the snapshot"},
                     {RPCResult::Type::NUM, "base_height", "the height of the base of the snapshot"},
                     {RPCResult::Type::STR, "path", "the absolute path that the snapshot was written to"},
@@ -2584,7 +2965,9 @@ static RPCHelpMan dumptxoutset()
     std::unique_ptr<CCoinsViewCursor> pcursor;
     CCoinsStats stats;
     CBlockIndex* tip;
+    uint64_t mweb_utxos_written;
     NodeContext& node = EnsureNodeContext(request.context);
+    const Consensus::Params& consensus_params = Params().GetConsensus();
 
     {
         // We need to lock cs_main to ensure that the coinsdb isn't written to
@@ -2599,6 +2982,9 @@ static RPCHelpMan dumptxoutset()
         // See discussion here:
         //   https://github.com/bitcoin/bitcoin/pull/15606#discussion_r274479369
         //
+        // The MWEB leafset and output PMMR have no such snapshots, so they
+        // are written out before cs_main is released.
+        //
         LOCK(::cs_main);
 
         ::ChainstateActive().ForceFlushStateToDisk();
@@ -2610,11 +2996,23 @@ static RPCHelpMan dumptxoutset()
         pcursor = std::unique_ptr<CCoinsViewCursor>(::ChainstateActive().CoinsDB().Cursor());
         tip = LookupBlockIndex(stats.hashBlock);
         CHECK_NONFATAL(tip);
-    }
 
-    SnapshotMetadata metadata{tip->GetBlockHash(), stats.coins_count, tip->nChainTx};
+        CBlock base_block;
+        if (!ReadBlockFromDisk(base_block, tip, consensus_params)) {
+            throw JSONRPCError(RPC_MISC_ERROR, "Unable to read the snapshot base block");
+        }
 
-    afile << metadata;
+        SnapshotMetadata metadata{tip->GetBlockHash(), stats.coins_count, tip->nChainTx};
+        afile << metadata;
+
+        mw::ICoinsView::Ptr mweb_view = ::ChainstateActive().CoinsDB().GetMWEBView();
+        CHECK_NONFATAL(mweb_view);
+        try {
+            mweb_utxos_written = WriteMWEBSnapshotState(afile, base_block, *mweb_view, node.rpc_interruption_point);
+        } catch (const std::runtime_error& e) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, e.what());
+        }
+    }
 
     COutPoint key;
     Coin coin;
@@ -2631,11 +3029,20 @@ static RPCHelpMan dumptxoutset()
         pcursor->Next();
     }
 
+    uint64_t mweb_kernels_written;
+    try {
+        mweb_kernels_written = WriteMWEBSnapshotKernels(afile, tip, consensus_params, node.rpc_interruption_point);
+    } catch (const std::runtime_error& e) {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+
     afile.fclose();
     fs::rename(temppath, path);
 
     UniValue result(UniValue::VOBJ);
     result.pushKV("coins_written", stats.coins_count);
+    result.pushKV("mweb_utxos_written", mweb_utxos_written);
+    result.pushKV("mweb_kernels_written", mweb_kernels_written);
     result.pushKV("base_hash", tip->GetBlockHash().ToString());
     result.pushKV("base_height", tip->nHeight);
     result.pushKV("path", path.string());
@@ -2644,6 +3051,109 @@ static RPCHelpMan dumptxoutset()
     };
 }
 
+static RPCHelpMan loadtxoutset()
+{
+    return RPCHelpMan{
+        "loadtxoutset",
+        "\nRead a UTXO snapshot written by dumptxoutset and validate it against the snapshot's base block.\n"
+        "Despite its name, this does not load the snapshot: it is not activated as a chainstate and the node's\n"
+        "chainstate is left unchanged.\n"
+        "The MWEB UTXOs and leafset are checked against the MWEB header committed to by the base block. Only the\n"
+        "kernels of the base block are checked against its kernel root; the kernels of earlier blocks are only\n"
+        "checked to balance with the UTXOs, not against the headers that committed to them.\n"
+        "The transparent coins are not committed to by any block, so their hash must be compared against\n"
+        "hash_serialized_2 from gettxoutsetinfo on a trusted node, either by passing it as expected_hash or\n"
+        "by comparing the result. The header of the base block must be known.\n",
+        {
+            {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "path to the snapshot file. If relative, will be prefixed by datadir."},
+            {"expected_hash", RPCArg::Type::STR_HEX, RPCArg::Optional::OMITTED_NAMED_ARG, "the expected hash_serialized_2 of the transparent coins"},
+        },
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::STR_HEX, "base_hash", "the hash of the base of the snapshot"},
+                    {RPCResult::Type::NUM, "base_height", "the height of the base of the snapshot"},
+                    {RPCResult::Type::NUM, "coins_count", "the number of coins in the snapshot"},
+                    {RPCResult::Type::STR_HEX, "hash_serialized_2", "the serialized hash of the transparent coins"},
+                    {RPCResult::Type::OBJ, "mweb", /* optional */ true, "the validated MWEB state (only if MWEB is active at the base block)",
+                    {
+                        {RPCResult::Type::NUM, "utxo_count", "the number of MWEB UTXOs"},
+                        {RPCResult::Type::NUM, "kernel_count", "the number of MWEB kernels"},
+                        {RPCResult::Type::STR_HEX, "header_hash", "the hash of the MWEB header"},
+                        {RPCResult::Type::STR_HEX, "output_root", "the root of the output PMMR"},
+                        {RPCResult::Type::STR_HEX, "leafset_root", "the root of the leafset"},
+                    }},
+                }
+        },
+        RPCExamples{
+            HelpExampleCli("loadtxoutset", "utxo.dat")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    FILE* file{fsbridge::fopen(path, "rb")};
+    CAutoFile afile{file, SER_DISK, CLIENT_VERSION};
+    if (afile.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Couldn't open file " + path.string() + " for reading");
+    }
+    NodeContext& node = EnsureNodeContext(request.context);
+    const Consensus::Params& consensus_params = Params().GetConsensus();
+
+    SnapshotMetadata metadata;
+    CCoinsStats stats;
+    const CBlockIndex* base;
+    std::unique_ptr<SnapshotMWEBValidator> mweb_validator;
+    try {
+        afile >> metadata;
+        base = WITH_LOCK(::cs_main, return LookupBlockIndex(metadata.m_base_blockhash));
+        if (!base) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Snapshot base block " + metadata.m_base_blockhash.ToString() + " is not known");
+        }
+
+        std::string error;
+        mweb_validator = MakeUnique<SnapshotMWEBValidator>(*base, consensus_params);
+        if (!mweb_validator->ReadState(afile, error, node.rpc_interruption_point)) {
+            throw JSONRPCError(RPC_VERIFY_ERROR, "Invalid MWEB state: " + error);
+        }
+
+        SnapshotCoinsView coins_view(afile, metadata);
+        if (!GetUTXOStats(&coins_view, stats, CoinStatsHashType::HASH_SERIALIZED, node.rpc_interruption_point) ||
+            stats.coins_count != metadata.m_coins_count) {
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, strprintf("Read %d of %d coins", stats.coins_count, metadata.m_coins_count));
+        }
+
+        if (!mweb_validator->ReadKernels(afile, error, node.rpc_interruption_point)) {
+            throw JSONRPCError(RPC_VERIFY_ERROR, "Invalid MWEB state: " + error);
+        }
+    } catch (const std::ios_base::failure& e) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, strprintf("Unable to read snapshot: %s", e.what()));
+    }
+
+    if (!request.params[1].isNull() && ParseHashV(request.params[1], "expected_hash") != stats.hashSerialized) {
+        throw JSONRPCError(RPC_VERIFY_ERROR, "Transparent coins hash " + stats.hashSerialized.GetHex() + " does not match the expected hash");
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("base_hash", base->GetBlockHash().GetHex());
+    result.pushKV("base_height", base->nHeight);
+    result.pushKV("coins_count", stats.coins_count);
+    result.pushKV("hash_serialized_2", stats.hashSerialized.GetHex());
+    const SnapshotMWEBState& mweb_state = mweb_validator->GetState();
+    if (mweb_state.m_active) {
+        const mw::Header::CPtr& header = mweb_state.m_proof.GetMWEBHeader();
+        UniValue mweb(UniValue::VOBJ);
+        mweb.pushKV("utxo_count", mweb_state.m_utxo_count);
+        mweb.pushKV("kernel_count", mweb_validator->GetKernelCount());
+        mweb.pushKV("header_hash", header->GetHash().ToHex());
+        mweb.pushKV("output_root", header->GetOutputRoot().ToHex());
+        mweb.pushKV("leafset_root", header->GetLeafsetRoot().ToHex());
+        result.pushKV("mweb", mweb);
+    }
+    return result;
+},
+    };
+}
+
 void RegisterBlockchainRPCCommands(CRPCTable &t)
 {
 // clang-format off
@@ -2667,6 +3177,9 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose", "mempool_sequence"} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {"hash_type"} },
+    { "blockchain",         "getcoinsflushinfo",      &getcoinsflushinfo,      {} },
+    { "blockchain",         "getdbstats",             &getdbstats,             {} },
+    { "blockchain",         "getsigcachestats",       &getsigcachestats,       {} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
@@ -2683,6 +3196,7 @@ static const CRPCCommand commands[] =
     { "hidden",             "waitforblockheight",     &waitforblockheight,     {"height","timeout"} },
     { "hidden",             "syncwithvalidationinterfacequeue", &syncwithvalidationinterfacequeue, {} },
     { "hidden",             "dumptxoutset",           &dumptxoutset,           {"path"} },
+    { "hidden",             "loadtxoutset",           &loadtxoutset,           {"path", "expected_hash"} },
 };
 // clang-format on
     for (const auto& c : commands) {
@@ -18,6 +18,7 @@ class CBlockIndex;
 class CConnman;
 class CTxMemPool;
 class ChainstateManager;
+class JSONStreamWriter;
 class UniValue;
 struct NodeContext;
 namespace util {
@@ -39,12 +40,16 @@ void RPCNotifyBlockChange(const CBlockIndex*);
 
 /** Block description to JSON */
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails = false) LOCKS_EXCLUDED(cs_main);
+/** Block description written straight into a JSON stream */
+void blockToJSON(JSONStreamWriter& writer, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails = false) LOCKS_EXCLUDED(cs_main);
 
 /** Mempool information to JSON */
 UniValue MempoolInfoToJSON(const CTxMemPool& pool);
 
 /** Mempool to JSON */
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose = false, bool include_mempool_sequence = false);
+/** Mempool written straight into a JSON stream, without holding the mempool lock while writing */
+void MempoolToJSON(JSONStreamWriter& writer, const CTxMemPool& pool, bool verbose = false, bool include_mempool_sequence = false);
 
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex) LOCKS_EXCLUDED(cs_main);
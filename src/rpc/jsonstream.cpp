@@ -0,0 +1,117 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/jsonstream.h>
+
+#include <univalue.h>
+
+#include <assert.h>
+
+JSONStreamWriter::JSONStreamWriter(FlushFn flush, size_t chunk_size)
+    : m_flush(std::move(flush)), m_chunk_size(chunk_size)
+{
+    m_buffer.reserve(m_chunk_size);
+}
+
+void JSONStreamWriter::BeginElement()
+{
+    if (m_after_key) {
+        m_after_key = false;
+        return;
+    }
+    if (m_first.empty()) return;
+    if (!m_first.back()) m_buffer += ',';
+    m_first.back() = false;
+}
+
+void JSONStreamWriter::MaybeFlush()
+{
+    if (m_buffer.size() >= m_chunk_size) Flush();
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    BeginElement();
+    m_buffer += '{';
+    m_first.push_back(true);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    assert(!m_first.empty() && !m_after_key);
+    m_first.pop_back();
+    m_buffer += '}';
+    MaybeFlush();
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    BeginElement();
+    m_buffer += '[';
+    m_first.push_back(true);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    assert(!m_first.empty() && !m_after_key);
+    m_first.pop_back();
+    m_buffer += ']';
+    MaybeFlush();
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!m_first.empty() && !m_after_key);
+    BeginElement();
+    m_buffer += UniValue(key).write();
+    m_buffer += ':';
+    m_after_key = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    switch (value.getType()) {
+    case UniValue::VOBJ:
+        BeginObject();
+        Members(value);
+        EndObject();
+        break;
+    case UniValue::VARR:
+        BeginArray();
+        for (size_t i = 0; i < value.size(); ++i) {
+            Value(value[i]);
+        }
+        EndArray();
+        break;
+    default:
+        BeginElement();
+        m_buffer += value.write();
+        MaybeFlush();
+        break;
+    }
+}
+
+void JSONStreamWriter::Members(const UniValue& obj)
+{
+    const std::vector<std::string>& keys = obj.getKeys();
+    const std::vector<UniValue>& values = obj.getValues();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        KeyValue(keys[i], values[i]);
+    }
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (m_buffer.empty()) return;
+    m_flush(m_buffer);
+    m_flushed = true;
+    m_buffer.clear();
+}
+
+std::string JSONStreamWriter::TakeBuffer()
+{
+    std::string ret;
+    ret.swap(m_buffer);
+    return ret;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_JSONSTREAM_H
+#define BITCOIN_RPC_JSONSTREAM_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class UniValue;
+
+/**
+ * Writes JSON incrementally, handing the output to a callback in chunks, so
+ * that a large RPC result does not have to exist as a UniValue tree and as a
+ * serialized string at the same time.
+ *
+ * The output is identical to UniValue::write() without indentation. Values
+ * can be written from a UniValue, which is itself streamed element by element.
+ */
+class JSONStreamWriter
+{
+public:
+    using FlushFn = std::function<void(const std::string& chunk)>;
+
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    explicit JSONStreamWriter(FlushFn flush, size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    /** Write the key of the next member of the current object */
+    void Key(const std::string& key);
+    /** Write a value, either as an array element or after Key() */
+    void Value(const UniValue& value);
+    void KeyValue(const std::string& key, const UniValue& value)
+    {
+        Key(key);
+        Value(value);
+    }
+    /** Write all members of obj as members of the current object */
+    void Members(const UniValue& obj);
+
+    /** Hand all buffered output to the callback */
+    void Flush();
+    /** Whether anything has been written since construction */
+    bool Empty() const { return m_buffer.empty() && !m_flushed; }
+    /** Whether any output has been handed to the callback */
+    bool Flushed() const { return m_flushed; }
+    /** Take the buffered output, for callers that handle small results themselves */
+    std::string TakeBuffer();
+
+private:
+    const FlushFn m_flush;
+    const size_t m_chunk_size;
+    std::string m_buffer;
+    bool m_flushed{false};
+    //! For each open object or array, whether no element was written yet
+    std::vector<bool> m_first;
+    //! Whether a key was written and its value is pending
+    bool m_after_key{false};
+
+    /** Write the separator needed before the next value or key */
+    void BeginElement();
+    void MaybeFlush();
+};
+
+#endif // BITCOIN_RPC_JSONSTREAM_H
@@ -737,6 +737,8 @@ static RPCHelpMan getblocktemplate()
     static CBlockIndex* pindexPrev;
     static int64_t nStart;
     static std::unique_ptr<CBlockTemplate> pblocktemplate;
+    // Transactions selected for the last template, extended by the next one
+    static BlockTemplateSelection selection;
     if (pindexPrev != ::ChainActive().Tip() ||
         (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
     {
@@ -750,7 +752,7 @@ static RPCHelpMan getblocktemplate()
 
         // Create new block
         CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate = BlockAssembler(mempool, Params()).CreateNewBlock(scriptDummy);
+        pblocktemplate = BlockAssembler(mempool, Params()).CreateNewBlock(scriptDummy, &selection);
         if (!pblocktemplate)
             throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
 
@@ -1061,6 +1063,8 @@ static RPCHelpMan estimatesmartfee()
                     RPCResult::Type::OBJ, "", "",
                     {
                         {RPCResult::Type::NUM, "feerate", /* optional */ true, "estimate fee rate in " + CURRENCY_UNIT + "/kB (only present if no errors were encountered)"},
+                        {RPCResult::Type::NUM, "mwebfeerate", /* optional */ true, "estimate fee rate of MWEB transactions in " + CURRENCY_UNIT + " per 1000 units of MWEB weight\n"
+            "(only present if enough MWEB transactions have been observed)"},
                         {RPCResult::Type::ARR, "errors", /* optional */ true, "Errors encountered during processing (if there are any)",
                             {
                                 {RPCResult::Type::STR, "", "error"},
@@ -1099,6 +1103,10 @@ static RPCHelpMan estimatesmartfee()
         errors.push_back("Insufficient data or no feerate found");
         result.pushKV("errors", errors);
     }
+    CFeeRate mwebFeeRate = ::feeEstimator.estimateSmartFee(conf_target, nullptr, conservative, FeeEstimateDimension::MWEB_WEIGHT);
+    if (mwebFeeRate != CFeeRate(0)) {
+        result.pushKV("mwebfeerate", ValueFromAmount(mwebFeeRate.GetFeePerK()));
+    }
     result.pushKV("blocks", feeCalc.returnedTarget);
     return result;
 },
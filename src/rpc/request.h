@@ -10,6 +10,7 @@
 
 #include <univalue.h>
 
+class JSONStreamWriter;
 namespace util {
 class Ref;
 } // namespace util
@@ -38,6 +39,9 @@ public:
     std::string URI;
     std::string authUser;
     std::string peerAddr;
+    //! If set, the handler may write its result into this stream instead of
+    //! returning it. It then returns a null value.
+    JSONStreamWriter* stream{nullptr};
     const util::Ref& context;
 
     JSONRPCRequest(const util::Ref& context) : id(NullUniValue), params(NullUniValue), fHelp(false), context(context) {}
@@ -47,7 +51,7 @@ public:
     //! added or removed above.
     JSONRPCRequest(const JSONRPCRequest& other, const util::Ref& context)
         : id(other.id), strMethod(other.strMethod), params(other.params), fHelp(other.fHelp), URI(other.URI),
-          authUser(other.authUser), peerAddr(other.peerAddr), context(context)
+          authUser(other.authUser), peerAddr(other.peerAddr), stream(other.stream), context(context)
     {
     }
 
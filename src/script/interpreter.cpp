@@ -1650,6 +1650,10 @@ bool GenericTransactionSignatureChecker<T>::VerifyECDSASignature(const std::vect
 template <class T>
 bool GenericTransactionSignatureChecker<T>::VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const
 {
+    if (m_schnorr_batch) {
+        m_schnorr_batch->Add(sig, pubkey, sighash);
+        return true;
+    }
     return pubkey.VerifySchnorr(sighash, sig);
 }
 
@@ -15,6 +15,7 @@
 
 class CPubKey;
 class XOnlyPubKey;
+class SchnorrSignatureBatch;
 class CScript;
 class CTransaction;
 class CTxOut;
@@ -255,6 +256,8 @@ private:
     unsigned int nIn;
     const CAmount amount;
     const PrecomputedTransactionData* txdata;
+    //! If set, Schnorr signatures are added to this batch instead of being verified right away
+    SchnorrSignatureBatch* m_schnorr_batch{nullptr};
 
 protected:
     virtual bool VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
@@ -267,6 +270,14 @@ public:
     bool CheckSchnorrSignature(Span<const unsigned char> sig, Span<const unsigned char> pubkey, SigVersion sigversion, const ScriptExecutionData& execdata, ScriptError* serror = nullptr) const override;
     bool CheckLockTime(const CScriptNum& nLockTime) const override;
     bool CheckSequence(const CScriptNum& nSequence) const override;
+
+    /** Defer Schnorr signature verification to a batch.
+     *
+     * This is only sound because every Schnorr signature that is checked and
+     * invalid makes the script fail: the script result is then only valid if
+     * the batch verifies too.
+     */
+    void SetSchnorrBatch(SchnorrSignatureBatch* batch) { m_schnorr_batch = batch; }
 };
 
 using TransactionSignatureChecker = GenericTransactionSignatureChecker<CTransaction>;
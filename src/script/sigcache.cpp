@@ -11,23 +11,69 @@
 #include <util/system.h>
 
 #include <cuckoocache.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+
 #include <boost/thread/shared_mutex.hpp>
 
 namespace {
+//! Number of independent parts of the signature cache
+static constexpr size_t SIGNATURE_CACHE_SHARDS = 16;
+
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * Entries are spread over several shards, each with its own cuckoo cache and
+ * lock. Lookups take the shard's lock shared, which suffices because the
+ * cache's erase flags are atomic, and inserts take it exclusively, so
+ * lookups and inserts only contend within one shard.
  */
 class CSignatureCache
 {
 private:
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+
+    struct alignas(64) Shard {
+        map_type setValid;
+        boost::shared_mutex cs_sigcache;
+        std::atomic<uint64_t> m_inserts{0};
+        std::atomic<uint32_t> m_size{0};
+        //! Updated by every lookup, so kept apart from what lookups read
+        alignas(64) std::atomic<uint64_t> m_hits{0};
+        std::atomic<uint64_t> m_misses{0};
+
+        bool Contains(const uint256& entry, bool erase)
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+            return setValid.contains(entry, erase);
+        }
+
+        //! Insert entries into the shard, taking its lock once for all of them
+        void Insert(const uint256* entries, size_t count)
+        {
+            boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+            for (size_t i = 0; i < count; ++i) {
+                setValid.insert(entries[i]);
+            }
+            m_inserts.fetch_add(count, std::memory_order_relaxed);
+        }
+    };
+
      //! Entries are SHA256(nonce || 'E' or 'S' || 31 zero bytes || signature hash || public key || signature):
     CSHA256 m_salted_hasher_ecdsa;
     CSHA256 m_salted_hasher_schnorr;
-    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
-    map_type setValid;
-    boost::shared_mutex cs_sigcache;
+    std::array<Shard, SIGNATURE_CACHE_SHARDS> m_shards;
+
+    Shard& GetShard(const uint256& entry)
+    {
+        // The low bits of the last hash SignatureCacheHasher derives from the
+        // entry hardly affect where the entry goes within its shard.
+        return m_shards[entry.begin()[28] % SIGNATURE_CACHE_SHARDS];
+    }
 
 public:
     CSignatureCache()
@@ -62,18 +108,55 @@ public:
     bool
     Get(const uint256& entry, const bool erase)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        Shard& shard = GetShard(entry);
+        const bool found = shard.Contains(entry, erase);
+        (found ? shard.m_hits : shard.m_misses).fetch_add(1, std::memory_order_relaxed);
+        return found;
     }
 
-    void Set(uint256& entry)
+    void Set(const uint256& entry)
     {
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-        setValid.insert(entry);
+        GetShard(entry).Insert(&entry, 1);
     }
+
+    void SetMany(std::vector<uint256>& entries)
+    {
+        // Group the entries by shard, so that each shard is locked once
+        std::sort(entries.begin(), entries.end(), [](const uint256& a, const uint256& b) {
+            return a.begin()[28] % SIGNATURE_CACHE_SHARDS < b.begin()[28] % SIGNATURE_CACHE_SHARDS;
+        });
+        for (size_t first = 0; first < entries.size();) {
+            Shard& shard = GetShard(entries[first]);
+            size_t last = first + 1;
+            while (last < entries.size() && &GetShard(entries[last]) == &shard) ++last;
+            shard.Insert(&entries[first], last - first);
+            first = last;
+        }
+    }
+
     uint32_t setup_bytes(size_t n)
     {
-        return setValid.setup_bytes(n);
+        uint32_t elements = 0;
+        for (Shard& shard : m_shards) {
+            boost::unique_lock<boost::shared_mutex> lock(shard.cs_sigcache);
+            shard.m_size = shard.setValid.setup_bytes(n / SIGNATURE_CACHE_SHARDS);
+            elements += shard.m_size;
+        }
+        return elements;
+    }
+
+    std::vector<SignatureCacheShardStats> GetStats() const
+    {
+        std::vector<SignatureCacheShardStats> stats;
+        for (const Shard& shard : m_shards) {
+            SignatureCacheShardStats shard_stats;
+            shard_stats.hits = shard.m_hits.load(std::memory_order_relaxed);
+            shard_stats.misses = shard.m_misses.load(std::memory_order_relaxed);
+            shard_stats.inserts = shard.m_inserts.load(std::memory_order_relaxed);
+            shard_stats.elements = shard.m_size.load(std::memory_order_relaxed);
+            stats.push_back(shard_stats);
+        }
+        return stats;
     }
 };
 
@@ -98,6 +181,16 @@ void InitSignatureCache()
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+void AddSignatureCacheEntries(std::vector<uint256>& entries)
+{
+    signatureCache.SetMany(entries);
+}
+
+std::vector<SignatureCacheShardStats> GetSignatureCacheStats()
+{
+    return signatureCache.GetStats();
+}
+
 bool CachingTransactionSignatureChecker::VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
@@ -106,7 +199,9 @@ bool CachingTransactionSignatureChecker::VerifyECDSASignature(const std::vector<
         return true;
     if (!TransactionSignatureChecker::VerifyECDSASignature(vchSig, pubkey, sighash))
         return false;
-    if (store)
+    if (store && m_entries)
+        m_entries->push_back(entry);
+    else if (store)
         signatureCache.Set(entry);
     return true;
 }
@@ -117,6 +212,10 @@ bool CachingTransactionSignatureChecker::VerifySchnorrSignature(Span<const unsig
     signatureCache.ComputeEntrySchnorr(entry, sighash, sig, pubkey);
     if (signatureCache.Get(entry, !store)) return true;
     if (!TransactionSignatureChecker::VerifySchnorrSignature(sig, pubkey, sighash)) return false;
-    if (store) signatureCache.Set(entry);
+    if (store && m_entries) {
+        m_entries->push_back(entry);
+    } else if (store) {
+        signatureCache.Set(entry);
+    }
     return true;
 }
@@ -45,9 +45,11 @@ class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
     bool store;
+    //! If set, the entries to store are collected here for AddSignatureCacheEntries()
+    std::vector<uint256>* m_entries;
 
 public:
-    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn), store(storeIn) {}
+    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn, std::vector<uint256>* entries = nullptr) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn), store(storeIn), m_entries(entries) {}
 
     bool VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
     bool VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const override;
@@ -55,4 +57,17 @@ public:
 
 void InitSignatureCache();
 
+/** Add the entries collected by CachingTransactionSignatureChecker to the cache, locking each shard once. */
+void AddSignatureCacheEntries(std::vector<uint256>& entries);
+
+struct SignatureCacheShardStats {
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t inserts{0};
+    //! The number of entries the shard can hold
+    uint32_t elements{0};
+};
+
+std::vector<SignatureCacheShardStats> GetSignatureCacheStats();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H